@@ -0,0 +1,53 @@
+// Build step: turns a dictionary bitmap into a header with its byte list, so the program does not decode it at start
+#include <fstream>
+#include <iostream>
+
+#include "aruco/aruco.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <dictionary.png> <output.hpp>" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        // Same reading as at runtime, correction bits are chosen by the program
+        const cv::Ptr<cv::aruco::Dictionary> dictionary = aruco::createDictionary(argv[1], 0);
+        const cv::Mat &bytes = dictionary->bytesList;
+
+        std::ofstream output(argv[2]);
+        output << "// Generated from " << argv[1] << " by embedDictionary, do not edit\n"
+               << "#pragma once\n\n"
+               << "namespace aruco\n{\n"
+               << "    namespace embedded\n    {\n"
+               << "        constexpr int MARKER_SIZE = " << dictionary->markerSize << ";\n"
+               << "        constexpr int MARKER_COUNT = " << bytes.rows << ";\n"
+               << "        constexpr int BYTES_PER_ROTATION = " << bytes.cols << ";\n\n"
+               << "        // cv::aruco::Dictionary::bytesList, CV_8UC4 with one channel per rotation\n"
+               << "        constexpr unsigned char BYTES_LIST[] = {";
+
+        const int total = static_cast<int>(bytes.total() * bytes.channels());
+        const unsigned char *data = bytes.ptr<unsigned char>();
+        for (int i = 0; i < total; ++i)
+            output << (i % 16 ? " " : "\n            ") << static_cast<int>(data[i]) << (i + 1 < total ? "," : "");
+
+        output << "\n        };\n"
+               << "    } // namespace embedded\n"
+               << "} // namespace aruco\n";
+
+        if (!output)
+        {
+            std::cerr << "Cannot write " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
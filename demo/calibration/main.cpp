@@ -1,13 +1,21 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <filesystem>
+#include <memory>
+#include <string>
 #include <vector>
 
-#include <opencv2/highgui/highgui.hpp>
 #include <opencv2/opencv.hpp>
 
-#include "cameraCalibration.h"
+#include "calib/cameraCalibration.hpp"
+#include "util/memoryBudget.hpp"
+#include "util/threadPool.hpp"
 #include "cxxopts.hpp"
 
+namespace fs = std::filesystem;
+
 cxxopts::ParseResult parseConfiguration(cxxopts::Options &options, int argc, const char *argv[])
 {
     try
@@ -33,6 +41,117 @@ bool endsWith(std::string const & value, std::string const & ending)
     return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
 }
 
+struct BatchCounters
+{
+    std::atomic<int> written{ 0 };
+    std::atomic<int> failed{ 0 };
+};
+
+// Gives memory of one image back to the budget however its task ends
+class BudgetReservation
+{
+private:
+    util::MemoryBudget &budget;
+    const size_t bytes;
+
+public:
+    BudgetReservation(util::MemoryBudget &budget, size_t bytes) : budget(budget), bytes(bytes) {}
+    ~BudgetReservation() { budget.release(bytes); }
+
+    BudgetReservation(const BudgetReservation &) = delete;
+    BudgetReservation &operator=(const BudgetReservation &) = delete;
+};
+
+// Remaps and encodes one image, runs on the pool
+void undistortAndWrite(const calibration::CameraCalibration &cameraCalibration, const cv::Mat &image,
+                       const fs::path &outputPath, BatchCounters &counters)
+{
+    try
+    {
+        cv::Mat undistorted;
+        cameraCalibration.undistort(image, undistorted);
+        if (cv::imwrite(outputPath.string(), undistorted))
+        {
+            counters.written++;
+            return;
+        }
+        std::cerr << "FAILURE: Cannot write \"" << outputPath.string() << "\"\n";
+    }
+    catch (const cv::Exception &ex)
+    {
+        // Future of the task is dropped, so the error has to be reported here
+        std::cerr << "FAILURE: Cannot write \"" << outputPath.string() << "\" (" << ex.what() << ")\n";
+    }
+    counters.failed++;
+}
+
+// Submits every input to the pool, blocks while images in flight use the whole budget
+void undistortInputs(const calibration::CameraCalibration &cameraCalibration, const std::vector<fs::path> &inputs,
+                     const fs::path &output_path, util::ThreadPool &pool, util::MemoryBudget &budget,
+                     BatchCounters &counters)
+{
+    // Decoding happens in workers, so the size of an image is known only from the previous one.
+    // Input and undistorted copy are alive at once, each one also needs an encoded buffer.
+    auto imageBytes = std::make_shared<std::atomic<size_t>>(0);
+    auto reservation = [imageBytes]() { return std::max<size_t>(*imageBytes, 1 << 20) * 3; };
+
+    for (const fs::path &input : inputs)
+    {
+        if(endsWith(input.string(), ".MP4"))
+        {
+            // Video is decoded in order on this thread, its frames are undistorted on the pool
+            cv::VideoCapture capture(input.string());
+            for (int frameNumber = 0;; ++frameNumber)
+            {
+                const size_t bytes = reservation();
+                budget.acquire(bytes);
+                cv::Mat frame;
+                capture >> frame;
+                if (frame.empty())
+                {
+                    budget.release(bytes);
+                    break;
+                }
+                *imageBytes = frame.total() * frame.elemSize();
+
+                const fs::path outputPath =
+                    output_path / (input.stem().string() + "_" + std::to_string(frameNumber) + ".png");
+                pool.submit([&cameraCalibration, &budget, &counters, frame, outputPath, bytes]() {
+                    const BudgetReservation reservation(budget, bytes);
+                    undistortAndWrite(cameraCalibration, frame, outputPath, counters);
+                });
+            }
+        }
+        else
+        {
+            const size_t bytes = reservation();
+            budget.acquire(bytes);
+            pool.submit([&cameraCalibration, &budget, &counters, &output_path, imageBytes, input, bytes]() {
+                const BudgetReservation reservation(budget, bytes);
+                cv::Mat image;
+                try
+                {
+                    image = cv::imread(input.string(), cv::IMREAD_COLOR);
+                }
+                catch (const cv::Exception &ex)
+                {
+                    std::cerr << "FAILURE: Cannot read \"" << input.string() << "\" (" << ex.what() << ")\n";
+                    counters.failed++;
+                    return;
+                }
+                if (image.empty())
+                {
+                    std::cerr << "FAILURE: Cannot read \"" << input.string() << "\"\n";
+                    counters.failed++;
+                    return;
+                }
+                *imageBytes = image.total() * image.elemSize();
+                undistortAndWrite(cameraCalibration, image, output_path / input.filename(), counters);
+            });
+        }
+    }
+}
+
 int main(int argc, const char *argv[])
 {
     cxxopts::Options options(argv[0], "Implementacje Przemyslowe");
@@ -40,14 +159,19 @@ int main(int argc, const char *argv[])
     ("h,help", "Display help")
     ("i,input_path", "Input settings file path", cxxopts::value<std::string>())
     ("d,calibration_path", "Input camera calibration file", cxxopts::value<std::string>())
-    ("c,image_list_path", "Images to be undistored path", cxxopts::value<std::string>());
+    ("c,image_list_path", "Directory with images and .MP4 videos to be undistorted", cxxopts::value<std::string>())
+    ("o,output_path", "Directory where undistorted images are written",
+     cxxopts::value<std::string>()->default_value("undistorted"))
+    ("t,threads", "Number of worker threads, 0 means one per core", cxxopts::value<int>()->default_value("0"))
+    ("m,memory_mb", "Memory of images decoded and undistorted at once",
+     cxxopts::value<int>()->default_value("512"));
 
     const auto config = parseConfiguration(options, argc, argv);
     const std::string input_path = config["input_path"].as<std::string>();
-    const std::string calibration_path = config["calibration_path"].as<std::string>();
-    const std::string image_list_path = config["image_list_path"].as<std::string>();
+    const std::string calibration_path = config.count("calibration_path") ? config["calibration_path"].as<std::string>() : "";
+    const std::string image_list_path = config.count("image_list_path") ? config["image_list_path"].as<std::string>() : "";
 
-    if (!std::experimental::filesystem::exists(input_path))
+    if (!fs::exists(input_path))
     {
         std::cerr << "FAILURE: Input file \"" << input_path << "\" does not exist.\n";
         exit(EXIT_FAILURE);
@@ -57,56 +181,43 @@ int main(int argc, const char *argv[])
     {
         calibration::CameraCalibration cameraCalibration(input_path);
         cameraCalibration.init();
+        return EXIT_SUCCESS;
     }
-    else
-    {
-        if(!image_list_path.empty())
-        {
-            calibration::CameraCalibration cameraCalibration(input_path, calibration_path);
-            namedWindow("DistortedImage", cv::WINDOW_NORMAL);
-            namedWindow("UndistortedImage", cv::WINDOW_NORMAL);
-            for (auto & p : std::experimental::filesystem::directory_iterator(image_list_path))
-            {
-                if(endsWith(p.path().string(), ".MP4"))
-                {
-                    cv::VideoCapture capture(p.path().string());
-                    cv::Mat frame;
-                    for (;;)
-                    {
-                        capture >> frame;
-                        if (frame.empty())
-                            break;
-                        cv::imshow("DistortedImage", frame);
-                        imshow("UndistortedImage", cameraCalibration.getUndistortedImage(frame));
-                        if(char(cv::waitKey(5)) == 27)  // if ESC
-                        {
-                            break;
-                        }
-                    }
-                }
-                else
-                {
-                    cv::Mat image = cv::imread(p.path().string(), CV_LOAD_IMAGE_COLOR);
-                    cv::imshow("DistortedImage", image);
-                    imshow("UndistortedImage", cameraCalibration.getUndistortedImage(image));
-                    int keyCode;
-                    while((keyCode = cv::waitKey(20)) == -1) {}
-                    if(char(keyCode) == 27)
-                    {
-                        break;
-                    }
-                }
-            }
-        }
-        else
-        {
-            std::cerr << "FAILURE: You have to provide image list path.\n";
-        }
 
+    if(image_list_path.empty())
+    {
+        std::cerr << "FAILURE: You have to provide image list path.\n";
+        exit(EXIT_FAILURE);
     }
 
+    const calibration::CameraCalibration cameraCalibration(input_path, calibration_path);
+    const fs::path output_path = config["output_path"].as<std::string>();
+    fs::create_directories(output_path);
 
-}
+    // Directory order is unspecified, sorted inputs give the same output on every run
+    std::vector<fs::path> inputs;
+    for (auto & p : fs::directory_iterator(image_list_path))
+        if (p.is_regular_file())
+            inputs.push_back(p.path());
+    std::sort(inputs.begin(), inputs.end());
 
+    // Workers remap whole images, OpenCV threads would only compete with them
+    cv::setNumThreads(1);
+    util::MemoryBudget budget(static_cast<size_t>(config["memory_mb"].as<int>()) << 20);
+    BatchCounters counters;
 
+    const auto start = std::chrono::steady_clock::now();
+    {
+        // Destructor of the pool waits for all submitted images
+        util::ThreadPool pool(config["threads"].as<int>());
+        undistortInputs(cameraCalibration, inputs, output_path, pool, budget, counters);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+    std::cout << "Undistorted " << counters.written << " images in " << seconds << " s ("
+              << (seconds > 0 ? counters.written / seconds : 0.0) << " images/s)";
+    if (counters.failed)
+        std::cout << ", " << counters.failed << " failed";
+    std::cout << std::endl;
+    return counters.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
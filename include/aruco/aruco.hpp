@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <type_traits>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <opencv2/aruco.hpp>
@@ -8,13 +10,21 @@ using namespace std;
 
 namespace aruco
 {
+    /*
+     * Plain value with four corners inline, so lists of markers are copied and stored
+     * without allocating per marker. Middle is computed once, table update asks for it often.
+     */
     class ArucoMarker 
     {
         int id;
-        vector<cv::Point2f> corners;
+        std::array<cv::Point2f, 4> corners;
+        cv::Point2f middle;
 
         public:
-            ArucoMarker(int id, const vector<cv::Point2f> &corners) : id(id), corners(corners) {}
+            ArucoMarker(int id, const std::array<cv::Point2f, 4> &corners);
+
+            // Detector always returns four corners per marker
+            ArucoMarker(int id, const vector<cv::Point2f> &corners);
             
             bool isValid() const
             {
@@ -26,23 +36,54 @@ namespace aruco
                 return id;
             }
 
-            const vector<cv::Point2f> &getCorners() const
+            const std::array<cv::Point2f, 4> &getCorners() const
             {
                 return corners;
             }
 
-            const cv::Point2f getMiddle() const;
+            cv::Point2f getMiddle() const
+            {
+                return middle;
+            }
 
             const static int INVALID_ID = -1;
     };
 
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 5)))
+    // Copies of cv::Point_ are defaulted since OpenCV 4.5.5, before that a marker is copied member by member
+    static_assert(std::is_trivially_copyable_v<ArucoMarker>, "ArucoMarker must stay a plain value");
+#endif
+
     cv::Ptr<cv::aruco::Dictionary> createDictionary(string path, int correction);
 
+    // Dictionary compiled in from data/dictionary.png at build time
+    cv::Ptr<cv::aruco::Dictionary> createEmbeddedDictionary(int correction);
+
     cv::Ptr<cv::aruco::DetectorParameters> loadParametersFromFile(string path = "");
 
+    // Outputs of OpenCV detector, kept between frames so their memory is reused
+    struct DetectionBuffers
+    {
+        vector<int> ids;
+        vector<vector<cv::Point2f>> corners;
+        vector<vector<cv::Point2f>> rejected;
+
+        // Scratch of the table decoder
+        cv::Mat gray, thresholded, warped;
+        vector<vector<cv::Point>> contours;
+        vector<cv::Point> polygon;
+        // Bit errors and perimeter of each found marker, the better of two candidates with same id wins
+        vector<std::pair<int, size_t>> scores;
+    };
+
     void detectArucoOnFrame(cv::Mat &frame, cv::Ptr<cv::aruco::Dictionary> arucoDictionary,
                             vector<ArucoMarker> &found, vector<ArucoMarker> &rejected,
                             cv::Ptr<cv::aruco::DetectorParameters> detectorParameters);
 
+    // Rejected candidates are collected only when list for them is given
+    void detectArucoOnFrame(const cv::Mat &frame, cv::Ptr<cv::aruco::Dictionary> arucoDictionary,
+                            vector<ArucoMarker> &found, cv::Ptr<cv::aruco::DetectorParameters> detectorParameters,
+                            DetectionBuffers &buffers, vector<ArucoMarker> *rejected = nullptr);
+
     void drawMarkersOnFrame(cv::Mat &frame, const vector<ArucoMarker> &markers);
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/aruco.hpp>
+
+#include "aruco/aruco.hpp"
+
+namespace aruco
+{
+    // Markers placed on table corners, index of marker is index of corner
+    const std::vector<int> TABLE_MARKER_IDS = { 0, 1, 2, 3 };
+
+    /*
+     * Detector specialized for the few markers marking the table. Only the given ids of the dictionary
+     * are kept, each in four rotations packed into an integer (row-major, one bit per cell), so
+     * a candidate is identified by popcount of xor instead of matching against the whole dictionary.
+     * Candidates with contour perimeter out of range are dropped before perspective removal,
+     * which is the expensive part. Uses the same detector parameters as cv::aruco.
+     */
+    class TableMarkerDecoder
+    {
+    private:
+        struct Code
+        {
+            int id;
+            // Code of marker rotated clockwise by 0, 90, 180 and 270 degrees
+            uint64_t rotations[4];
+        };
+
+        std::vector<Code> codes;
+        int markerSize;
+        int maxCorrectionBits;
+        cv::Ptr<cv::aruco::DetectorParameters> parameters;
+
+        bool readCode(const cv::Mat &gray, const std::array<cv::Point2f, 4> &corners, DetectionBuffers &buffers,
+                      uint64_t &code) const;
+        int identify(uint64_t code, int &index, int &rotation) const;
+
+    public:
+        // Accepts as many bit errors as cv::aruco does, maxCorrectionBits of dictionary scaled by errorCorrectionRate
+        TableMarkerDecoder(cv::Ptr<cv::aruco::Dictionary> dictionary, const std::vector<int> &ids,
+                           cv::Ptr<cv::aruco::DetectorParameters> parameters);
+
+        // Thread safe, all scratch memory is in buffers
+        void detect(const cv::Mat &frame, vector<ArucoMarker> &found, DetectionBuffers &buffers) const;
+
+        static uint64_t rotateClockwise(uint64_t code, int markerSize);
+    };
+} // namespace aruco
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <opencv2/core.hpp>
+
+#include "util/mappedFile.hpp"
+
+namespace calibration
+{
+    /*
+     * On-disk layout of the calibration cache sidecar. File starts with CacheHeader, undistortion
+     * maps (CV_16SC2 and CV_16UC1, as initUndistortRectifyMap makes them) follow when mapWidth is
+     * not zero. Values are in native byte order, maps are used in place from the mapped file; cache
+     * written on a machine of the other endianness fails the version check and is rebuilt.
+     */
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;        // FNV-1a of calibration XML, used to detect stale cache
+        int32_t mapWidth;
+        int32_t mapHeight;
+        uint32_t distCoeffCount;
+        uint32_t flags;
+        double cameraMatrix[9];
+        double distCoeffs[14];      // Longest distortion model supported by OpenCV
+        uint8_t padding[40];        // Maps start at 256 bytes
+    };
+
+    static_assert(sizeof(CacheHeader) == 256, "Calibration cache header must be packed");
+
+    /*
+     * Camera parameters read from calibration XML once and memory-mapped afterwards. Maps stored
+     * in the cache are used in place, so processes which calibrate with the same file share them.
+     */
+    class CalibrationCache
+    {
+    private:
+        std::shared_ptr<const util::MappedFile> file;
+        const CacheHeader *header;
+
+    public:
+        // Version 2 stores model flags where version 1 had a reserved field
+        const static uint32_t VERSION = 2;
+        const static uint32_t FISHEYE = 1;
+
+        static std::string defaultPath(const std::string &calibrationPath) { return calibrationPath + ".cache"; }
+        static uint64_t hashFile(const std::string &path);
+
+        // Maps are optional, empty maps store only camera parameters
+        static void write(const std::string &cachePath, uint64_t sourceHash, const cv::Mat &cameraMatrix,
+                          const cv::Mat &distCoeffs, const cv::Mat &map1, const cv::Mat &map2,
+                          bool fisheye = false);
+
+        explicit CalibrationCache(const std::string &cachePath);
+
+        uint64_t getSourceHash() const { return header->sourceHash; }
+        bool isFisheye() const { return header->flags & FISHEYE; }
+        cv::Mat getCameraMatrix() const;
+        cv::Mat getDistCoeffs() const;
+
+        bool hasMaps() const { return header->mapWidth > 0; }
+        cv::Size getMapSize() const { return cv::Size(header->mapWidth, header->mapHeight); }
+
+        // Maps point into the mapped file, which must be kept as long as they are used
+        cv::Mat getMap1() const;
+        cv::Mat getMap2() const;
+        std::shared_ptr<const util::MappedFile> getFile() const { return file; }
+    };
+} // namespace calibration
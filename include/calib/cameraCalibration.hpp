@@ -1,8 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <ctime>
 #include <cstdio>
 #include <opencv2/core.hpp>
@@ -11,6 +15,8 @@
 #include <opencv2/calib3d.hpp>
 #include <opencv2/highgui.hpp>
 
+#include "util/mappedFile.hpp"
+
 class Settings
 {
 public:
@@ -49,6 +55,13 @@ public:
     bool fixK3;                     // fix K3 distortion coefficient
     bool fixK4;                     // fix K4 distortion coefficient
     bool fixK5;                     // fix K5 distortion coefficient
+    bool parallelDetection;         // Detect pattern on many frames at once without GUI (image list and video only)
+    float minSharpness;             // Frames with lower variance of Laplacian are skipped in parallel detection
+    int searchWidth;                // Pattern is searched on view downscaled to this width, 0 means full resolution
+    int maxViews;                   // At most this many views spread over pattern poses are solved, 0 keeps all
+    float outlierRatio;             // Views with error above this multiple of the median may be dropped, 0 keeps all
+    bool searchModel;               // Choose distortion model by held-out error instead of using the one above
+    float convergence;              // Live capture stops once intrinsics change relatively less than this, 0 disables
 
     int cameraID;
     std::vector<std::string> imageList;
@@ -67,11 +80,33 @@ namespace calibration
     class CameraCalibration
     {
     private:
+        struct UndistortMaps
+        {
+            cv::Mat map1, map2;
+            // Set when maps point into the calibration cache
+            std::shared_ptr<const util::MappedFile> file;
+        };
+
         cv::Mat cameraMatrix;
         cv::Mat distCoeffs;
+        bool fisheye = false;
+        // Incremented by every setParameters, tells which parameters a frame was undistorted with
+        uint64_t generation = 0;
+
+        // Undistortion maps are computed once per image size and shared by all users
+        mutable std::mutex mapsMutex;
+        mutable std::map<std::pair<int, int>, std::shared_ptr<const UndistortMaps>> undistortMaps;
+        std::shared_ptr<const UndistortMaps> getUndistortMaps(cv::Size imageSize, uint64_t &generation) const;
+        static std::shared_ptr<UndistortMaps> computeUndistortMaps(const cv::Mat& cameraMatrix,
+            const cv::Mat& distCoeffs, bool fisheye, cv::Size imageSize);
         std::string inputSettingsFile = "default.xml";
         std::string calibrationFileName;
 
+        // Hash of loaded calibration file, zero when parameters did not come from it
+        uint64_t calibrationHash = 0;
+        // Maps of the first undistorted size are written to the cache once
+        mutable bool cacheHasMaps = false;
+
         enum { DETECTION = 0, CAPTURING = 1, CALIBRATED = 2 };
         
         bool runCalibrationAndSave(Settings& s, cv::Size imageSize, cv::Mat& cameraMatrix,
@@ -91,6 +126,21 @@ namespace calibration
             std::vector<cv::Mat>& rvecs, std::vector<cv::Mat>& tvecs, std::vector<float>& reprojErrs,
             double& totalAvgErr);
 
+        // Quiet solve of the model given by settings, safe to run from many threads at once.
+        // With useGuess the given camera matrix and coefficients are refined instead of starting from scratch.
+        static double solve(const Settings& s, const cv::Size& imageSize,
+            const std::vector<std::vector<cv::Point3f> >& objectPoints,
+            const std::vector<std::vector<cv::Point2f> >& imagePoints,
+            cv::Mat& cameraMatrix, cv::Mat& distCoeffs, std::vector<cv::Mat>& rvecs, std::vector<cv::Mat>& tvecs,
+            bool useGuess = false);
+
+        // Running solution of live capture, refined from the previous one after each new view
+        static double refine(const Settings& s, const cv::Size& imageSize,
+            const std::vector<std::vector<cv::Point2f> >& imagePoints, cv::Mat& cameraMatrix, cv::Mat& distCoeffs);
+
+        // Largest relative change of focal lengths and principal point
+        static double intrinsicsChange(const cv::Mat& previous, const cv::Mat& next);
+
 	    static void saveCameraParams(Settings& s, cv::Size& imageSize, cv::Mat& cameraMatrix,
             cv::Mat& distCoeffs, const std::vector<cv::Mat>& rvecs, const std::vector<cv::Mat>& tvecs,
             const std::vector<float>& reprojErrs,
@@ -98,10 +148,46 @@ namespace calibration
 
 	    void loadCalibrationFile();
 
+        // Variance of Laplacian on half resolution, low for blurred frames
+        static double sharpness(const cv::Mat& view);
+
+        // Non-interactive capture, first nrFrames views with pattern in input order
+        static void collectViews(Settings& s, cv::Size& imageSize, std::vector<std::vector<cv::Point2f>>& imagePoints);
+
     public:
         static void help();
 
-        cv::Mat getUndistortedImage(cv::Mat distortedImage);
+        // Keeps at most maxViews views, spread over position, size and tilt of the pattern
+        static void selectViews(const Settings& s, const cv::Size& imageSize,
+            std::vector<std::vector<cv::Point2f> >& imagePoints);
+
+        // Drops views which spoil the solution one by one, candidates are evaluated in parallel
+        static void rejectOutlierViews(const Settings& s, const cv::Size& imageSize,
+            std::vector<std::vector<cv::Point2f> >& imagePoints);
+
+        // Finds calibration pattern on a color view and refines its points
+        static bool findPattern(const Settings& s, const cv::Mat& view, std::vector<cv::Point2f>& pointBuf);
+
+        // Solves candidate models in parallel and sets flags of the one with the lowest held-out error
+        static void searchModel(Settings& s, const cv::Size& imageSize,
+            const std::vector<std::vector<cv::Point2f> >& imagePoints);
+
+        cv::Mat getUndistortedImage(cv::Mat distortedImage) const;
+
+        // Writes into given image, which is reused when it already has the right size.
+        // Returns generation of parameters the image was undistorted with.
+        uint64_t undistort(const cv::Mat &distortedImage, cv::Mat &undistortedImage) const;
+
+        // Copies of current parameters, online refinement may replace them at any time
+        void getParameters(cv::Mat &cameraMatrix, cv::Mat &distCoeffs, bool &fisheye) const;
+
+        // Maps of image sizes in use are computed before the swap, so undistortion never waits for them
+        void setParameters(const cv::Mat &cameraMatrix, const cv::Mat &distCoeffs);
+
+        // Inverse of undistort for points, gives their position in the distorted image. Points must come
+        // from an image undistorted with given generation, false when parameters were replaced since then.
+        bool distortPoints(const std::vector<cv::Point2f> &undistorted, std::vector<cv::Point2f> &distorted,
+                           uint64_t generation) const;
 
         CameraCalibration() {}; 
         
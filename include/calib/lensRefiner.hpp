@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "calib/cameraCalibration.hpp"
+
+namespace calibration
+{
+    struct LensRefinerOptions
+    {
+        // Side of table markers in the same units as table size
+        float markerSize = 0;
+        // Frames between two kept views, consecutive frames add nothing but noise
+        int viewInterval = 30;
+        // Mean shift in pixels of table points between a view and the last kept one, views changed less are skipped
+        double minViewChange = 20;
+        // Oldest views are dropped above this count, half of them is held out for validation
+        int maxViews = 60;
+        // Parameters are refined when this many views were added since the last refinement
+        int refineEvery = 10;
+        // Relative decrease of held-out error needed before refined parameters are used
+        double minImprovement = 0.05;
+        // Refined parameters are written here in calibration file format, empty to keep them in memory only
+        std::string outputPath;
+    };
+
+    /*
+     * Refines camera parameters in the background from corners of the table markers, whose
+     * positions on the table plane are known, so no chessboard is needed. Views of one table
+     * differ little, so only focal length and radial distortion are solved, starting from the
+     * current parameters. Every other view is held out of the fit, refined parameters replace
+     * the current ones only when they reproject the held-out views clearly better.
+     *
+     * Views are kept only when the camera sees the table from a different pose than in the last
+     * kept view. With a camera mounted still nothing is refined, it is useful after re-mounting
+     * the camera or on videos where it moves, so the table is seen from various poses.
+     */
+    class LensRefiner
+    {
+    private:
+        struct View
+        {
+            std::vector<cv::Point3f> objectPoints;
+            // Corners in the distorted input frame
+            std::vector<cv::Point2f> imagePoints;
+        };
+
+        const std::shared_ptr<CameraCalibration> calibration;
+        const LensRefinerOptions options;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<View> views;
+        // Mapping of table plane to the undistorted frame in the last kept view
+        cv::Mat lastHomography;
+        cv::Size imageSize;
+        int framesSinceView, viewsSinceRefinement;
+        bool stopping;
+        std::thread worker;
+
+        void work();
+        bool refine(const std::vector<View> &views, cv::Size imageSize);
+
+        // Mean distance between table points mapped by two homographies
+        static double viewChange(const std::vector<cv::Point2f> &planePoints, const cv::Mat &previous,
+                                 const cv::Mat &next);
+
+        static double reprojectionError(const std::vector<View> &views, const cv::Mat &cameraMatrix,
+                                        const cv::Mat &distCoeffs, bool fisheye);
+
+    public:
+        LensRefiner(std::shared_ptr<CameraCalibration> calibration, const LensRefinerOptions &options);
+        ~LensRefiner();
+
+        LensRefiner(const LensRefiner &) = delete;
+        LensRefiner &operator=(const LensRefiner &) = delete;
+
+        // Called for every processed frame with marker corners found on the undistorted frame and generation
+        // undistort() returned for it, returns immediately, refinement runs on the worker thread
+        void addView(const std::vector<cv::Point3f> &objectPoints, const std::vector<cv::Point2f> &undistortedPoints,
+                     cv::Size imageSize, uint64_t generation);
+    };
+} // namespace calibration
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+namespace detection
+{
+    /*
+     * Receiver of intermediate images of detection steps (e.g. a set of debug windows). Detection
+     * hands over only images it computes anyway, so running without a sink costs nothing.
+     */
+    class DebugSink
+    {
+    public:
+        virtual ~DebugSink() = default;
+
+        virtual void debugFrame(const std::string &title, const cv::Mat &frame) = 0;
+    };
+} // namespace detection
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <memory_resource>
 #include <vector>
 #include <opencv2/opencv.hpp>
 
+#include "detection/debugSink.hpp"
+
 using namespace std;
 
 namespace detection
@@ -13,11 +16,76 @@ namespace detection
     	RED_PLAYERS
 	};
 
+	typedef std::pmr::vector<cv::Point> Contour;
+
+	/*
+	 * Ball candidates of one frame pair and state of the tracker after them. Lists are allocated
+	 * from given memory (per-frame arena in sessions), copies use the default heap.
+	 */
+	struct BallDetection
+	{
+		std::pmr::vector<Contour> contours;
+		std::pmr::vector<cv::Rect> boxes;
+
+		// Kalman prediction made before candidates were measured, only when ball was being followed
+		bool predicted = false;
+		cv::Rect predictedBox;
+
+		// Position, velocity and size of the ball (x, y, vx, vy, w, h) after correction
+		cv::Vec6f kalmanState;
+		cv::Point center;
+		bool found = false;
+
+		explicit BallDetection(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+			: contours(memory), boxes(memory) {}
+	};
+
+	struct PlayersDetection
+	{
+		std::pmr::vector<Contour> contours;
+		std::pmr::vector<cv::Rect> boxes;
+
+		explicit PlayersDetection(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+			: contours(memory), boxes(memory) {}
+	};
+
+	// Everything detected on one frame pair of a table
+	struct FrameDetections
+	{
+		BallDetection ball;
+		PlayersDetection redPlayers;
+		PlayersDetection bluePlayers;
+
+		explicit FrameDetections(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+			: ball(memory), redPlayers(memory), bluePlayers(memory) {}
+	};
+
+	/*
+	 * Table seen in the camera frame, for detection without warping the frame into table space.
+	 * Masks of getMaskForMode are brought into the frame through the inverse homography, and only
+	 * found contours are transformed into table coordinates.
+	 */
+	struct CameraRegion
+	{
+		// Table corners masks were built for
+		std::vector<cv::Point2f> corners;
+		// Bounding box of the table in the frame, detection runs only inside of it
+		cv::Rect roi;
+		// Homography from pixels of ROI to table pixels
+		cv::Mat toTable;
+		// Masks of ROI size indexed by Mode, zero outside of the table quad
+		cv::Mat masks[3];
+	};
+
 	cv::Scalar getColorForMode(detection::Mode mode, int colorIndex);
 	cv::Mat getMaskForMode(Mode mode, cv::Size size);
     cv::Mat transformToHSV(cv::Mat image, Mode mode);
+    cv::Mat transformToHSV(cv::Mat image, Mode mode, const cv::Mat& mask);
 	cv::Mat tracking(cv::Mat image1, cv::Mat image2);
 
+	// Maps contour points through homography, empty homography leaves them as they are
+	void transformContours(vector<vector<cv::Point> >& contours, const cv::Mat& homography);
+
 	class FoundBallsState
 	{
 	private:
@@ -31,9 +99,8 @@ namespace detection
 		cv::Mat state;  
     	cv::Mat meas;
 			
+		// Output of findContours, kept between frames so its memory is reused
 		vector<vector<cv::Point> > contours;
-        vector<vector<cv::Point> > balls;
-    	vector<cv::Rect> ballsBox;
 
 		FoundBallsState(double ticks, bool foundball, int notFoundCount);
 
@@ -42,7 +109,7 @@ namespace detection
 
 		cv::Point getCenter() const { return center; }
 
-		bool getFoundball() {return foundball; }
+		bool getFoundball() const {return foundball; }
 		void setFoundball(bool newFoundball) {foundball = newFoundball; }
 
 		int getNotFoundCount() {return notFoundCount; }
@@ -51,40 +118,44 @@ namespace detection
 	    cv::Point getCenter() {return center; }
         void setCenter(cv::Point x);
 
-		void clearVectors()
-		{
-			contours.clear();
-			balls.clear();
-			ballsBox.clear();
-		}
-
-		void contoursFiltering(cv::Mat& rangeRes);
-		void detectedBalls(cv::Mat& res, double dT);
-		void detectedBallsResult(cv::Mat& res);
-		void updateFilter();
+		// Contours are moved into table coordinates by toTable when given
+		void contoursFiltering(cv::Mat& rangeRes, BallDetection& ball, const cv::Mat& toTable = cv::Mat());
+		cv::Rect predict(double dT);
+		void measure(const std::pmr::vector<cv::Rect>& boxes);
+		void updateFilter(const std::pmr::vector<cv::Rect>& boxes);
 	};
 
 	class PlayersFinder
 	{		
 	public:
+		// Output of findContours, kept between frames so its memory is reused
         vector<vector<cv::Point> > players;
-        vector<cv::Rect> playersBox;
 
 		PlayersFinder() {}
 
-		void clearVectors()
-		{
-			players.clear();
-			playersBox.clear();
-		}
-
-		void contoursFiltering(cv::Mat& rangeRes);
-		void detectedPlayersResult(cv::Mat& res, Mode mode);
+		void contoursFiltering(cv::Mat& rangeRes, PlayersDetection& result, const cv::Mat& toTable = cv::Mat());
 	};
+
+	// Copies contours which look like a ball (square-ish and big enough) into candidates
+	void filterBallCandidates(const vector<vector<cv::Point> >& contours, BallDetection& ball);
+	void collectPlayers(const vector<vector<cv::Point> >& contours, PlayersDetection& players);
 	
-	void detectPlayers(bool detectionEnabled, bool debugMode, Mode mode,
-        PlayersFinder& playersFinder, cv::Mat& frame, cv::Mat& restul);
+	// Detection steps have no side effects besides updating given state,
+	// images they work on are passed to the sink when one is attached
+	void detectPlayersOnFrame(Mode mode, PlayersFinder& playersFinder, const cv::Mat& frame,
+        PlayersDetection& players, DebugSink* debugSink = nullptr);
+
+	void trackBallOnFrames(FoundBallsState& foundBallsState, double deltaTicks,
+        const cv::Mat& frame, const cv::Mat& nextFrame, BallDetection& ball, DebugSink* debugSink = nullptr);
+
+	// Same steps on the table region of camera frames, results are in table coordinates
+	void detectPlayersInRegion(Mode mode, PlayersFinder& playersFinder, const cv::Mat& frame,
+        const CameraRegion& region, PlayersDetection& players, DebugSink* debugSink = nullptr);
+
+	void trackBallInRegion(FoundBallsState& foundBallsState, double deltaTicks,
+        const cv::Mat& frame, const cv::Mat& nextFrame, const CameraRegion& region, BallDetection& ball,
+        DebugSink* debugSink = nullptr);
 
-	void trackBall(bool trackingEnabled, bool debugMode, FoundBallsState& foundBallsState,
-        double deltaTicks, int& founded, int& counter, cv::Mat& frame, cv::Mat& nextFrame, cv::Mat& restul);
+	void drawBallDetection(cv::Mat& res, const BallDetection& ball);
+	void drawPlayersDetection(cv::Mat& res, const PlayersDetection& players, Mode mode);
 } // namespace detection
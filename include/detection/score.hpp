@@ -1,12 +1,13 @@
 #pragma once
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 namespace detection
 {
     class ScoreCounter
     {
-    private:
+    public:
         enum class LastEventType
         {
             EV_OUT, 
@@ -15,6 +16,15 @@ namespace detection
             EV_GOOL_RIGHT
         };
 
+        // Confirmed event along with frame in which ball disappeared and frame of confirmation
+        struct Event
+        {
+            LastEventType type;
+            int detectedAt;
+            int confirmedAt;
+        };
+
+    private:
         int scoreLeft, scoreRight;
         int scoreOuts;
         const cv::Point tableSize;
@@ -22,8 +32,10 @@ namespace detection
         bool clearFlag;
 
         LastEventType lastEvent;
+        int lastEventFrame;
         int notFoundSince;
-        void confirmLastEvent();
+        std::vector<Event> events;
+        void confirmLastEvent(int frame);
         bool isBallOutOfTable(const cv::Point &lastPosition);
 
     public:
@@ -33,12 +45,19 @@ namespace detection
               scoreOuts(0),
               tableSize(tableSize), 
               clearFlag(false),
-              fps(fps) {}
+              fps(fps),
+              lastEvent(LastEventType::EV_NONE),
+              lastEventFrame(0),
+              notFoundSince(0) {}
+
+        void trackBallAndScore(const cv::Point &lastPosition, bool isValid, int frame = 0);
 
-        void trackBallAndScore(const cv::Point &lastPosition, bool isValid);
+        // True when ball left the table, but the event is not confirmed yet
+        bool hasPendingEvent() const { return lastEvent != LastEventType::EV_NONE; }
 
         int getScoreLeft() const { return scoreLeft; }
         int getScoreRight() const { return scoreRight; }
         int getScoreOuts() const { return scoreOuts; }
+        const std::vector<Event> &getEvents() const { return events; }
     };
 } // namespace score
@@ -5,22 +5,38 @@
 #include <opencv2/aruco.hpp>
 
 #include "aruco/aruco.hpp"
+#include "detection/detection.hpp"
 
 namespace detection
 {
+    /*
+     * Table acquisition: nothing is known until all four markers are seen once. After that a frame
+     * with one marker hidden (e.g. by a player's arm) completes the missing corner from the three
+     * seen ones and the last known geometry, and frames with fewer markers keep the last table.
+     */
+    enum class TableState
+    {
+        SEARCHING,      // No table yet, there is nothing to detect on
+        ACQUIRED,       // All four markers seen on the last frame
+        COMPLETED,      // Three markers seen, fourth corner predicted
+        HELD            // Too few markers, last table is kept
+    };
+
     class Table 
     {
     private:
         std::vector<cv::Point2f> corners;
+        // Corners the current transformation was computed from
+        std::vector<cv::Point2f> lastCorners;
         cv::Mat transformationMatrix;
-        bool transformationValid;
+        TableState state;
 
         cv::Point2f output[4];
         const cv::Size output_size;
 
     public:
         Table(int width, int height)
-            : corners(4), output_size(width, height), transformationValid(false)
+            : corners(4), state(TableState::SEARCHING), output_size(width, height)
         {
             output[0] = { (float)width, 0 };
             output[1] = { (float)width, (float)height };
@@ -29,8 +45,24 @@ namespace detection
         }
 
         void updateTableOnFrame(const std::vector<aruco::ArucoMarker> &arucoMarkers);
+        TableState getState() const { return state; }
+        bool hasTable() const { return state != TableState::SEARCHING; }
         void drawTableOnFrame(cv::Mat &frame);
         cv::Mat getTableFromFrame(const cv::Mat &frame);
+        void getTableFromFrame(const cv::Mat &frame, cv::Mat &table);
+        cv::Rect getBoundingRect() const;
+        const std::vector<cv::Point2f> &getCorners() const { return corners; }
+
+        // Prepares region for detection in camera frame, masks are rebuilt only after table moved by a pixel
+        bool updateCameraRegion(cv::Size frameSize, CameraRegion &region) const;
+
+        // Corners of all four markers on the table plane (in output image units) and in the frame, only
+        // when all of them were seen on the last frame.
+        // Markers are assumed square with given side and aligned with table edges, the marker corner chosen as
+        // table corner lies exactly at the table corner.
+        bool getMarkerCorrespondences(const std::vector<aruco::ArucoMarker> &arucoMarkers, float markerSize,
+                                      std::vector<cv::Point3f> &objectPoints,
+                                      std::vector<cv::Point2f> &imagePoints) const;
         const cv::Point getSize() const { return (cv::Point) output_size; };
     };
 }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "detection/detection.hpp"
+#include "gui/gui.hpp"
+
+namespace gui
+{
+    // Everything needed to draw one processed frame, owned by the snapshot
+    struct DisplayFrame
+    {
+        cv::Mat original;
+        cv::Mat table;
+        detection::FrameDetections detections;
+        std::vector<std::pair<std::string, cv::Mat>> debugFrames;
+        int scoreLeft = 0, scoreRight = 0, scoreOuts = 0;
+        cv::Point ballCenter;
+        int foundCount = 0, processedCount = 0;
+
+        // Buffers the frame pool had to request from the system while processing this frame
+        long long frameAllocations = 0;
+    };
+
+    /*
+     * Shows frames posted by processing at a fixed rate and handles keys. Processing never waits
+     * for the window system: the mailbox holds one frame and a newer frame replaces the one which
+     * was not displayed yet. Window calls are made only by the thread which runs the display.
+     */
+    class Display
+    {
+    private:
+        Controls &controls;
+        const std::chrono::milliseconds period;
+        const cv::Size tableSize;
+
+        std::mutex mutex;
+        DisplayFrame mailbox;
+        bool mailboxFull;
+
+        std::vector<std::string> openWindows;
+
+        // Border, key help and labels are drawn once into the background, which then only
+        // restores the bands with changing text; the table is drawn straight into the canvas
+        cv::Mat background, canvas;
+        cv::Rect tableArea, scoreBand, statisticsBand;
+        int valuesX;
+
+        void render(const DisplayFrame &frame);
+        void showWindow(const std::string &title, const cv::Mat &image, std::vector<std::string> &shown);
+
+    public:
+        Display(Controls &controls, double rate, cv::Size tableSize);
+
+        void post(DisplayFrame frame);
+
+        // Displays frames until quit is requested by a key or by processing
+        void run();
+    };
+} // namespace gui
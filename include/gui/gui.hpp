@@ -1,20 +1,51 @@
-#pragma
+#pragma once
 
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
 #include <opencv2/opencv.hpp>
+#include "detection/debugSink.hpp"
+#include "detection/detection.hpp"
 #include "detection/score.hpp"
 
 namespace gui
 {
-	void showOriginalFrame(bool originalEnabled, cv::Mat& frame);
+    // Switches changed by keys on display thread and read by processing thread
+    struct Controls
+    {
+        std::atomic<bool> originalEnabled { false };
+        std::atomic<bool> trackingEnabled { true };
+        std::atomic<bool> blueDetectionEnabled { false };
+        std::atomic<bool> redDetectionEnabled { false };
+        std::atomic<bool> debugMode { false };
+        std::atomic<bool> paused { false };
+        std::atomic<bool> quit { false };
+    };
 
-    void handlePressedKeys(int key, bool& originalEnabled, bool& trackingEnabled,
-                           bool& blueDetectionEnabled, bool& redDetectionEnabled, bool& pause, bool& debugMode);
+    // Keeps copies of debug frames, so they can be shown later by another thread
+    class DebugFrameCollector : public detection::DebugSink
+    {
+    public:
+        std::vector<std::pair<std::string, cv::Mat>> frames;
+
+        void debugFrame(const std::string& title, const cv::Mat& frame) override;
+    };
+
+    void drawDetections(cv::Mat& frame, const detection::FrameDetections& detections);
+
+    void handlePressedKeys(int key, Controls& controls);
 	
     void printKeyDoc(cv::Mat& frame, int x, int y);
 	
-    void printScoreBoard(detection::ScoreCounter& scoreCounter, cv::Mat &res, int x, int y);
+    void printScoreBoard(int scoreLeft, int scoreRight, int scoreOuts, cv::Mat &res, int x, int y);
 	
+    // Static labels of ball position and tracking accuracy, returns x where their values start
+    int printStatisticsLabels(cv::Mat& res, int x, int y);
+
     void showCenterPosition(cv::Mat& res, cv::Point center, int x, int y);
 	
     void showStatistics(cv::Mat& res, int founded, int all, int x, int y);
+
+    void showAllocations(cv::Mat& res, long long allocations, int x, int y);
 }
\ No newline at end of file
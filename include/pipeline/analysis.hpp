@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "detection/score.hpp"
+#include "pipeline/assets.hpp"
+#include "pipeline/result.hpp"
+#include "util/threadPool.hpp"
+#include "video/keyframeIndex.hpp"
+#include "video/sampler.hpp"
+#include "video/segment.hpp"
+
+namespace pipeline
+{
+    struct AnalysisOptions
+    {
+        video::FrameSampler sampler;
+
+        // Each range is preceded by this much warm-up for Kalman filter, table and score counter
+        double overlapSeconds;
+    };
+
+    // Past its end a range is followed as long as an event which started inside of it waits for confirmation.
+    // Confirmation counts processed frames, with skipping they may span much more than the warm-up.
+    inline bool isRangeFinished(const video::Segment &range, int position, const detection::ScoreCounter &scoreCounter)
+    {
+        return position >= range.end && !scoreCounter.hasPendingEvent();
+    }
+
+    // Uses keyframe index sidecar of the video, building it first when needed
+    std::shared_ptr<const video::KeyframeIndex> loadOrBuildIndex(const std::string &videoPath);
+
+    Result analyzeRange(const std::string &videoPath, std::shared_ptr<const video::KeyframeIndex> index,
+                        video::Segment range, const Assets &assets, const AnalysisOptions &options);
+
+    // Splits video into keyframe-aligned chunks, analyzes them on the pool and stitches results
+    Result analyzeVideo(const std::string &videoPath, const Assets &assets,
+                        const AnalysisOptions &options, util::ThreadPool &pool, int chunks);
+} // namespace pipeline
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <opencv2/aruco.hpp>
+
+#include "json.hpp"
+#include "aruco/tableDecoder.hpp"
+#include "calib/cameraCalibration.hpp"
+#include "calib/lensRefiner.hpp"
+
+namespace pipeline
+{
+    // Read-only objects created once from configuration and shared by all sessions
+    struct Assets
+    {
+        cv::Ptr<cv::aruco::Dictionary> arucoDictionary;
+        cv::Ptr<cv::aruco::DetectorParameters> detectorParameters;
+        // Set when table markers are decoded by the specialized decoder instead of cv::aruco
+        std::shared_ptr<const aruco::TableMarkerDecoder> tableDecoder;
+        std::shared_ptr<const calibration::CameraCalibration> cameraCalibration;
+        // Set when camera parameters are refined online, only for sessions watching the calibrated camera
+        std::shared_ptr<calibration::LensRefiner> lensRefiner;
+        // Side of table markers in table units, known marker geometry for lens refinement
+        float tableMarkerSize;
+        cv::Size tableSize;
+        // Detection runs on the table region of camera frames, which are not warped into table space
+        bool cameraSpaceDetection;
+    };
+
+    Assets loadAssets(const nlohmann::json &config);
+} // namespace pipeline
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "pipeline/analysis.hpp"
+#include "pipeline/assets.hpp"
+#include "util/threadPool.hpp"
+
+namespace pipeline
+{
+    struct BatchOptions
+    {
+        std::string outputDirectory;
+
+        // Upper bound of memory used by frames of all videos analyzed at the same time
+        size_t memoryBudget;
+    };
+
+    struct BatchSummary
+    {
+        int analyzed;
+        int skipped;
+        int failed;
+    };
+
+    // Arguments may be video files, directories with videos or wildcard patterns (* and ?) of file names
+    std::vector<std::string> expandVideoPaths(const std::vector<std::string> &patterns);
+
+    // Result file of the video inside output directory, its existence marks the video as done
+    std::string batchResultPath(const std::string &videoPath, const BatchOptions &options);
+
+    // Rough size of frames one analysis keeps alive, based on resolution of the video
+    size_t estimateAnalysisMemory(const std::string &videoPath, cv::Size tableSize);
+
+    /*
+     * Analyzes each video sequentially on one worker of the pool, many videos at once. All jobs
+     * share the same read-only assets. Videos which already have result file are skipped, so
+     * interrupted batch continues where it stopped.
+     */
+    BatchSummary analyzeBatch(const std::vector<std::string> &videoPaths, const Assets &assets,
+                              const AnalysisOptions &analysisOptions, const BatchOptions &options,
+                              util::ThreadPool &pool);
+} // namespace pipeline
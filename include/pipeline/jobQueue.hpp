@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "pipeline/result.hpp"
+#include "video/segment.hpp"
+
+namespace pipeline
+{
+    // Range of frames of one video analyzed by a single shard worker
+    struct Job
+    {
+        std::string name;
+        std::string video;
+        video::Segment range;
+    };
+
+    /*
+     * Queue of jobs kept in a directory shared by all workers, without any coordinator:
+     *   jobs/<name>.json     - job description, added once by enqueue
+     *   locks/<name>.lock    - exclusive claim of a job holding worker id, its modification time is worker's heartbeat
+     *   results/<name>.json  - written atomically when job is finished
+     *   results/<name>.error - reason of failure, removing it puts the job back to the queue
+     * Locks which were not refreshed for longer than timeout belong to dead workers and are broken,
+     * so their jobs return to the queue. Clocks of machines have to agree within the timeout.
+     */
+    class JobQueue
+    {
+    private:
+        std::filesystem::path directory;
+        std::string workerId;
+        std::chrono::milliseconds timeout;
+
+        std::filesystem::path jobPath(const std::string &name) const;
+        std::filesystem::path lockPath(const std::string &name) const;
+        bool isStale(const std::filesystem::path &lock) const;
+        bool isOwnLock(const std::filesystem::path &lock) const;
+
+    public:
+        JobQueue(const std::string &directory, const std::string &workerId, std::chrono::milliseconds timeout);
+
+        // Host name and process id, unique among processes sharing the directory
+        static std::string defaultWorkerId();
+
+        // Adding a job which is already in the queue does nothing, so enqueue can be repeated
+        void add(const Job &job);
+        std::vector<Job> getJobs() const;
+
+        std::string resultPath(const Job &job) const;
+        bool isDone(const Job &job) const;
+        bool isFailed(const Job &job) const;
+        // Every job is either done or failed
+        bool isFinished() const;
+
+        bool claim(const Job &job);
+        std::optional<Job> claimNext();
+        void heartbeat(const Job &job);
+        void complete(const Job &job, const Result &result);
+        void fail(const Job &job, const std::string &reason);
+        // Lock broken as stale and claimed by another worker meanwhile is left to it
+        void release(const Job &job);
+
+        // Breaks stale locks and returns number of requeued jobs
+        int requeueStale();
+    };
+} // namespace pipeline
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "json.hpp"
+#include "detection/score.hpp"
+#include "video/segment.hpp"
+
+namespace pipeline
+{
+    struct TrajectoryPoint
+    {
+        int frame;
+        cv::Point position;
+        bool found;
+    };
+
+    // Outcome of analysis of a whole video or of one range of its frames
+    struct Result
+    {
+        std::string video;
+        video::Segment range;
+        std::vector<TrajectoryPoint> trajectory;
+        std::vector<detection::ScoreCounter::Event> events;
+    };
+
+    nlohmann::json toJson(const Result &result);
+    Result resultFromJson(const nlohmann::json &json);
+
+    // Result file is replaced atomically, so it either exists complete or does not exist at all
+    void writeResult(const std::string &path, const Result &result);
+    Result readResult(const std::string &path);
+
+    // Joins results of adjacent ranges of one video into a single result
+    Result mergeResults(std::vector<Result> parts);
+} // namespace pipeline
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pipeline/analysis.hpp"
+#include "pipeline/assets.hpp"
+#include "pipeline/result.hpp"
+#include "pipeline/session.hpp"
+#include "util/threadPool.hpp"
+#include "video/frameSource.hpp"
+
+namespace pipeline
+{
+    /*
+     * Serves many video streams (e.g. one camera per table) with a shared thread pool. Every
+     * stream has its own session and is processed in short steps; a stream has at most one step
+     * in flight, so its frames stay in order while different streams run on different cores.
+     */
+    class Scheduler
+    {
+    private:
+        struct Stream
+        {
+            video::FrameSource source;
+            Session session;
+            Result result;
+
+            Stream(const std::string &path, const Assets &assets) : source(path), session(assets)
+            {
+                session.getOptions().tableFrameEnabled = false;
+            }
+        };
+
+        // Frame pairs processed by one step before the stream yields its thread to other streams
+        const static int PAIRS_PER_STEP = 8;
+
+        const Assets &assets;
+        const AnalysisOptions &options;
+        util::ThreadPool &pool;
+        std::vector<std::unique_ptr<Stream>> streams;
+
+        std::mutex mutex;
+        std::condition_variable streamFinished;
+        size_t runningStreams;
+
+        void schedule(Stream &stream);
+        bool step(Stream &stream);
+
+    public:
+        Scheduler(const Assets &assets, const AnalysisOptions &options, util::ThreadPool &pool);
+
+        // Path of video file, camera URL or anything else cv::VideoCapture opens
+        void addStream(const std::string &path);
+
+        // Processes all streams until they end, results are in order of added streams
+        std::vector<Result> run();
+    };
+} // namespace pipeline
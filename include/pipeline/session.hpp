@@ -0,0 +1,93 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "aruco/aruco.hpp"
+#include "detection/debugSink.hpp"
+#include "detection/detection.hpp"
+#include "detection/score.hpp"
+#include "detection/table.hpp"
+#include "pipeline/assets.hpp"
+#include "util/frameArena.hpp"
+#include "util/framePool.hpp"
+
+namespace pipeline
+{
+    // Detection steps enabled for a session, may be toggled between frames
+    struct SessionOptions
+    {
+        bool trackingEnabled = true;
+        bool redDetectionEnabled = false;
+        bool blueDetectionEnabled = false;
+        // Marker corners are fed to the lens refiner of assets, if there is one
+        bool lensRefinementEnabled = false;
+        // Table frame is needed only for display when detection runs in camera space
+        bool tableFrameEnabled = true;
+    };
+
+    /*
+     * All state needed to analyze one table: table position, ball tracker, players finders and
+     * score counter. Sessions share only read-only assets and never touch windows, so many of
+     * them can run at the same time.
+     */
+    class Session
+    {
+    private:
+        const Assets &assets;
+        SessionOptions options;
+        detection::Table table;
+        detection::FoundBallsState ballsState;
+        detection::PlayersFinder redPlayersFinder, bluePlayersFinder;
+        detection::ScoreCounter scoreCounter;
+        std::vector<aruco::ArucoMarker> found;
+        std::vector<cv::Point3f> markerObjectPoints;
+        std::vector<cv::Point2f> markerImagePoints;
+        aruco::DetectionBuffers arucoBuffers;
+        int processedCount, foundCount;
+
+        // Temporaries of one frame pair, detections of the last pair are allocated from it
+        util::FrameArena arena;
+        std::optional<detection::FrameDetections> detections;
+
+        // Stage outputs are written in place, into pooled buffers when there is a pool
+        cv::MatAllocator *frameAllocator;
+        cv::Mat undistortedFrame, undistortedNextFrame, tableFrame, nextTableFrame;
+
+        // Masks and homography of camera space detection, rebuilt when table moves
+        detection::CameraRegion cameraRegion;
+
+        void detectMarkers(const cv::Mat &frame);
+        void addLensRefinementView(cv::Size frameSize, uint64_t calibrationGeneration);
+        void detectOnTableFrames(double deltaTicks, detection::DebugSink *debugSink);
+        void detectInCameraRegion(double deltaTicks, detection::DebugSink *debugSink);
+
+    public:
+        Session(const Assets &assets);
+
+        SessionOptions &getOptions() { return options; }
+
+        // Pool has to outlive the session
+        void useFramePool(util::FramePool *framePool) { frameAllocator = framePool; }
+
+        // Analyzes frame at given source position along with the frame which follows it,
+        // intermediate images of detection go to the debug sink if there is one
+        const detection::FrameDetections &process(const cv::Mat &frame, const cv::Mat &nextFrame, int position, double fps,
+                                                  detection::DebugSink *debugSink = nullptr);
+
+        const detection::Table &getTable() const { return table; }
+        const detection::FoundBallsState &getBallsState() const { return ballsState; }
+        const detection::ScoreCounter &getScoreCounter() const { return scoreCounter; }
+
+        // Statistics of ball tracking, counted only while tracking is enabled
+        int getProcessedCount() const { return processedCount; }
+        int getFoundCount() const { return foundCount; }
+
+        const detection::FrameDetections &getDetections() const { return *detections; }
+
+        // Table cut out of the last processed frame, in the same coordinates as detections;
+        // with camera space detection it is made only when tableFrameEnabled is set
+        const cv::Mat &getTableFrame() const { return tableFrame; }
+    };
+} // namespace pipeline
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "pipeline/analysis.hpp"
+#include "pipeline/assets.hpp"
+#include "pipeline/jobQueue.hpp"
+
+namespace pipeline
+{
+    // Adds jobs for the videos, splitting each one into given number of keyframe-aligned chunks
+    int enqueueVideos(JobQueue &queue, const std::vector<std::string> &videoPaths, int chunks);
+
+    /*
+     * Claims and analyzes jobs with given number of threads until all jobs of the queue are done.
+     * Locks of claimed jobs are refreshed every heartbeat period while they are analyzed.
+     */
+    void runShardWorker(JobQueue &queue, const Assets &assets, const AnalysisOptions &options,
+                        int threads, std::chrono::milliseconds heartbeatPeriod);
+
+    // Combines results of all jobs of each finished video into one result file per video
+    int mergeShardResults(const JobQueue &queue, const std::string &outputDirectory);
+} // namespace pipeline
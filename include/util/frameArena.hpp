@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace util
+{
+    /*
+     * Monotonic memory for temporaries of one frame (candidate lists, boxes, copied contours).
+     * Allocation is a pointer bump and everything is dropped at once by reset(). When a frame
+     * does not fit, the overflow goes to the heap and the arena grows by that much on reset,
+     * so after a few frames the heap is not touched at all.
+     */
+    class FrameArena
+    {
+    private:
+        // Heap behind the arena, counts what did not fit into the buffer
+        class Upstream : public std::pmr::memory_resource
+        {
+        public:
+            size_t frameBytes = 0;
+            long long allocations = 0;
+
+        protected:
+            void *do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void *pointer, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+        };
+
+        size_t capacity;
+        std::unique_ptr<std::byte[]> buffer;
+        Upstream upstream;
+        std::optional<std::pmr::monotonic_buffer_resource> resource;
+
+    public:
+        explicit FrameArena(size_t capacity = 64 << 10);
+
+        FrameArena(const FrameArena &) = delete;
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        std::pmr::memory_resource *get() { return &*resource; }
+
+        // Called once per frame, after everything allocated from the arena was destroyed
+        void reset();
+
+        size_t getCapacity() const { return capacity; }
+        long long getHeapAllocations() const { return upstream.allocations; }
+    };
+} // namespace util
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace util
+{
+    /*
+     * OpenCV allocator recycling page-aligned frame buffers. Buffers are preallocated for
+     * frames of input resolution and of table size, and a released buffer waits in the pool
+     * for the next frame of the same size instead of going back to the system. Mats keep
+     * their reference counting, so a buffer still shown by GUI is not reused until released.
+     */
+    class FramePool : public cv::MatAllocator
+    {
+    private:
+        const size_t pageSize;
+        const size_t buffersPerSize;
+        const bool hugePages;
+
+        mutable std::mutex mutex;
+        mutable std::map<size_t, std::vector<void *>> freeBuffers;
+        mutable std::atomic<long long> allocations;
+        mutable std::atomic<long long> reuses;
+
+        size_t roundToPages(size_t bytes) const;
+        void *mapBuffer(size_t bytes) const;
+        void unmapBuffer(void *buffer, size_t bytes) const;
+
+        void *acquire(size_t bytes) const;
+        void release(void *buffer, size_t bytes) const;
+
+    public:
+        // Keeps at most given number of free buffers of each size, huge pages are used when system allows
+        FramePool(cv::Size inputSize, cv::Size tableSize, size_t buffersPerSize, bool hugePages = false);
+        ~FramePool();
+
+        FramePool(const FramePool &) = delete;
+        FramePool &operator=(const FramePool &) = delete;
+
+        cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags,
+                               cv::UMatUsageFlags usageFlags) const override;
+        bool allocate(cv::UMatData *data, int accessFlags, cv::UMatUsageFlags usageFlags) const override;
+        void deallocate(cv::UMatData *data) const override;
+
+        // Buffers which had to be requested from the system, the rest came from the pool
+        long long getAllocations() const { return allocations; }
+        long long getReuses() const { return reuses; }
+    };
+
+    /*
+     * Prepares output of a stage which is written in place: a buffer still shared with someone
+     * else (e.g. a frame waiting for display) is left to them, and new buffer comes from allocator
+     * (OpenCV default one when null).
+     */
+    void leaseBuffer(cv::Mat &mat, cv::MatAllocator *allocator);
+} // namespace util
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace util
+{
+    /*
+     * Read-only memory mapping of a whole file. Pages are shared between all processes which
+     * map the same file, so large read-only data (indexes, precomputed maps) is loaded once.
+     */
+    class MappedFile
+    {
+    private:
+        const uint8_t *data;
+        size_t size;
+#ifdef _WIN32
+        void *fileHandle;
+        void *mappingHandle;
+#endif
+
+    public:
+        explicit MappedFile(const std::string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const uint8_t *getData() const { return data; }
+        size_t getSize() const { return size; }
+    };
+} // namespace util
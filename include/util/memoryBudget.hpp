@@ -0,0 +1,33 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace util
+{
+    /*
+     * Counting semaphore measured in bytes. Jobs reserve their estimated memory before start,
+     * so number of jobs in flight depends on their size and not only on number of threads.
+     */
+    class MemoryBudget
+    {
+    private:
+        const size_t limit;
+        size_t used;
+        std::mutex mutex;
+        std::condition_variable released;
+
+    public:
+        explicit MemoryBudget(size_t limit);
+
+        MemoryBudget(const MemoryBudget &) = delete;
+        MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+        // Blocks until the bytes fit, a single reservation larger than limit is let through alone
+        void acquire(size_t bytes);
+        void release(size_t bytes);
+
+        size_t getUsed();
+    };
+} // namespace util
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+    // Fixed number of worker threads executing submitted tasks in FIFO order
+    class ThreadPool
+    {
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping;
+
+        void work();
+
+    public:
+        // Zero means one thread per hardware core
+        explicit ThreadPool(size_t threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t size() const { return workers.size(); }
+
+        template <typename Task>
+        auto submit(Task task) -> std::future<decltype(task())>
+        {
+            auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+            auto future = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push([packaged]() { (*packaged)(); });
+            }
+            condition.notify_one();
+            return future;
+        }
+    };
+} // namespace util
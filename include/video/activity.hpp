@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "video/frameSource.hpp"
+#include "video/segment.hpp"
+
+namespace video
+{
+    // Segments are ranges of frames in which somebody plays at the table
+    std::vector<Segment> readSegments(const std::string &path, const std::string &videoPath);
+    void writeSegments(const std::string &path, const std::string &videoPath,
+                       const std::vector<Segment> &segments);
+
+    /*
+     * Cheap motion probe: region of interest is downscaled to a tiny luma image and compared
+     * with the previous probe. Frame is active when enough probe pixels have changed. The first
+     * probe after construction or reset() is never active, it only becomes the baseline.
+     */
+    class ActivityDetector
+    {
+    private:
+        const cv::Size probeSize;
+        const double activeFraction;
+        cv::Mat small, current, previous, difference;
+
+    public:
+        ActivityDetector(cv::Size probeSize, double activeFraction)
+            : probeSize(probeSize), activeFraction(activeFraction) {}
+
+        bool isActive(const cv::Mat &frame, const cv::Rect &roi);
+        void reset() { previous.release(); }
+    };
+
+    /*
+     * Watches processed frames and decides when recording went idle. In that case fastForward()
+     * grabs frames in large steps, decoding only one probe frame per step, until activity is
+     * seen again. Segments with activity are collected, so they can be saved and replayed later
+     * with skipIdle() without any detection.
+     */
+    class ActivityMonitor
+    {
+    private:
+        ActivityDetector detector;
+        const int idleFrames;
+        const int fastForwardStep;
+
+        std::vector<Segment> segments;
+        std::vector<Segment> knownSegments;
+        bool segmentOpen;
+        int segmentBegin, lastActive;
+        cv::Mat probe;
+
+    public:
+        ActivityMonitor(int idleFrames, int fastForwardStep, double activeFraction);
+
+        // Segments are detected only when they were not loaded from previous run
+        bool isDetecting() const { return idleFrames > 0 && knownSegments.empty(); }
+
+        // Use segments detected in one of previous runs instead of detecting them again
+        void useKnownSegments(const std::vector<Segment> &segments) { knownSegments = segments; }
+
+        // Returns true when nothing moved for long enough and stream should be fast-forwarded
+        bool update(const cv::Mat &frame, const cv::Rect &roi, int position, bool ballFound);
+
+        // Skips idle part of stream, returns false when stream has ended
+        bool fastForward(FrameSource &source, const cv::Rect &roi);
+
+        // Jumps to the next known segment if current position is outside of all of them
+        bool skipIdle(FrameSource &source) const;
+
+        const std::vector<Segment> &getSegments() const { return segments; }
+
+        // Closes currently open segment and returns all detected ones
+        const std::vector<Segment> &finish(int position);
+    };
+} // namespace video
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "video/keyframeIndex.hpp"
+
+namespace video
+{
+    /*
+     * Thin wrapper around cv::VideoCapture which keeps track of the stream position, so callers
+     * can skip frames without decoding them and still know which source frame they are at.
+     */
+    class FrameSource
+    {
+    private:
+        cv::VideoCapture capture;
+        int position;
+        double fps;
+        cv::Size frameSize;
+        std::shared_ptr<const KeyframeIndex> index;
+
+    public:
+        const static int DEFAULT_FPS = 24;
+
+        FrameSource(const std::string &path);
+
+        bool isOpened() const { return capture.isOpened(); }
+
+        // With keyframe index, seeks always land on a keyframe and grab forward from there
+        void useIndex(std::shared_ptr<const KeyframeIndex> keyframeIndex) { index = keyframeIndex; }
+
+        // Decodes next frame into BGR image
+        bool read(cv::Mat &frame);
+
+        // Advances over given number of frames using grab() only, without decoding them
+        bool skip(int frames);
+
+        // Jumps directly to given frame, next read() returns that frame
+        bool seek(int frame);
+
+        // Index of the next frame which will be returned by read()
+        int getPosition() const { return position; }
+        double getFps() const { return fps; }
+        cv::Size getFrameSize() const { return frameSize; }
+    };
+} // namespace video
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/mappedFile.hpp"
+#include "video/segment.hpp"
+
+namespace video
+{
+    /*
+     * On-disk layout of the keyframe index sidecar. File starts with IndexHeader followed by
+     * entryCount IndexEntry records sorted by frame. Values are in native byte order, as the file
+     * is mapped and read in place; index written on a machine of the other endianness fails the
+     * version check.
+     */
+    struct IndexHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t flags;
+        uint32_t timescale;     // PTS units per second
+        uint64_t frameCount;
+        double fps;
+        uint64_t entryCount;
+        uint64_t videoSize;     // Size of indexed video file, used to detect stale index
+    };
+
+    struct IndexEntry
+    {
+        uint64_t frame;         // Frame number in presentation order
+        int64_t pts;
+        uint64_t byteOffset;    // Offset of keyframe data in video file
+    };
+
+    static_assert(sizeof(IndexHeader) == 48, "Keyframe index header must be packed");
+    static_assert(sizeof(IndexEntry) == 24, "Keyframe index entry must be packed");
+
+    /*
+     * Keyframe positions of a video. Index is built once by scanning container metadata
+     * (only MP4/MOV sample tables are parsed; for other containers evenly spaced seek points
+     * are stored instead and EXACT_KEYFRAMES flag is not set) and later memory-mapped.
+     */
+    class KeyframeIndex
+    {
+    private:
+        std::unique_ptr<util::MappedFile> file;
+        const IndexHeader *header;
+        const IndexEntry *entries;
+
+    public:
+        const static uint32_t VERSION = 1;
+        const static uint32_t EXACT_KEYFRAMES = 1;
+
+        static std::string defaultPath(const std::string &videoPath) { return videoPath + ".fidx"; }
+        static void build(const std::string &videoPath, const std::string &indexPath);
+
+        explicit KeyframeIndex(const std::string &indexPath);
+
+        bool isExact() const { return header->flags & EXACT_KEYFRAMES; }
+        bool matches(const std::string &videoPath) const;
+
+        size_t size() const { return header->entryCount; }
+        const IndexEntry &operator[](size_t i) const { return entries[i]; }
+
+        int getFrameCount() const { return static_cast<int>(header->frameCount); }
+        double getFps() const { return header->fps; }
+        uint32_t getTimescale() const { return header->timescale; }
+
+        // Nearest keyframe at or before given frame
+        int keyframeAtOrBefore(int frame) const;
+
+        // Splits the whole video into at most given number of ranges starting at keyframes
+        std::vector<Segment> split(int parts) const;
+    };
+} // namespace video
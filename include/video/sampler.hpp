@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+#include "detection/detection.hpp"
+
+namespace video
+{
+    enum class SamplingPolicy
+    {
+        FIXED,
+        ADAPTIVE
+    };
+
+    SamplingPolicy parseSamplingPolicy(const std::string &name);
+
+    /*
+     * Decides how many source frames can be skipped after each processed frame.
+     * FIXED policy always skips the same number of frames. ADAPTIVE policy uses the ball state
+     * estimated by Kalman filter: it skips as many frames as the ball needs to travel
+     * targetDisplacement pixels, less when the position estimate is uncertain, and maxSkip frames
+     * when no ball is tracked at all.
+     */
+    class FrameSampler
+    {
+    private:
+        SamplingPolicy policy;
+        int fixedSkip;
+        int minSkip, maxSkip;
+        double targetDisplacement;
+
+    public:
+        FrameSampler(SamplingPolicy policy, int fixedSkip, int minSkip, int maxSkip,
+                     double targetDisplacement)
+            : policy(policy),
+              fixedSkip(fixedSkip),
+              minSkip(minSkip),
+              maxSkip(maxSkip),
+              targetDisplacement(targetDisplacement) {}
+
+        int framesToSkip(const detection::FoundBallsState &ballsState, double fps) const;
+    };
+} // namespace video
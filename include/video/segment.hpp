@@ -0,0 +1,11 @@
+#pragma once
+
+namespace video
+{
+    // Range of source frames [begin, end)
+    struct Segment
+    {
+        int begin;
+        int end;
+    };
+} // namespace video
@@ -114,29 +114,41 @@ namespace aruco
         std::vector<ArucoMarker> &found, std::vector<ArucoMarker> &rejected,
         cv::Ptr<cv::aruco::DetectorParameters> detectorParameters)
     {
-        std::vector<int> markerIds;
-        std::vector<std::vector<cv::Point2f>> markerCorners;
-        std::vector<std::vector<cv::Point2f>> markerRejected;
+        DetectionBuffers buffers;
+        detectArucoOnFrame(frame, arucoDictionary, found, detectorParameters, buffers, &rejected);
+    }
 
+    void detectArucoOnFrame(const cv::Mat &frame, cv::Ptr<cv::aruco::Dictionary> arucoDictionary,
+        std::vector<ArucoMarker> &found, cv::Ptr<cv::aruco::DetectorParameters> detectorParameters,
+        DetectionBuffers &buffers, std::vector<ArucoMarker> *rejected)
+    {
+        // Buffers are resized by the detector, not cleared, so inner vectors keep their capacity
         found.clear();
-        rejected.clear();
-        cv::aruco::detectMarkers(frame, arucoDictionary, markerCorners, 
-            markerIds, detectorParameters, markerRejected);
-
-        found.reserve(markerIds.size());
-        for (int i = 0; i < markerIds.size(); ++i)
-            found.push_back(ArucoMarker(markerIds[i], markerCorners[i]));
-
-        rejected.reserve(markerRejected.size());
-        for (int i = 0; i < markerRejected.size(); ++i)
-            rejected.push_back(ArucoMarker(ArucoMarker::INVALID_ID, markerRejected[i]));
+        if (rejected)
+            cv::aruco::detectMarkers(frame, arucoDictionary, buffers.corners, 
+                buffers.ids, detectorParameters, buffers.rejected);
+        else
+            cv::aruco::detectMarkers(frame, arucoDictionary, buffers.corners, 
+                buffers.ids, detectorParameters, cv::noArray());
+
+        found.reserve(buffers.ids.size());
+        for (int i = 0; i < buffers.ids.size(); ++i)
+            found.emplace_back(buffers.ids[i], buffers.corners[i]);
+
+        if (!rejected)
+            return;
+
+        rejected->clear();
+        rejected->reserve(buffers.rejected.size());
+        for (int i = 0; i < buffers.rejected.size(); ++i)
+            rejected->emplace_back(ArucoMarker::INVALID_ID, buffers.rejected[i]);
     }
 
     void drawMarkersOnFrame(cv::Mat &frame, const std::vector<ArucoMarker> &markers)
     {
         for (const ArucoMarker &marker : markers) {
             auto color = (marker.isValid() ? CV_RGB(0, 255, 0) : CV_RGB(255, 0, 0));
-            const std::vector<cv::Point2f> & corners = marker.getCorners();
+            const std::array<cv::Point2f, 4> &corners = marker.getCorners();
 
             cv::line(frame, corners[0], corners[1], color);
             cv::line(frame, corners[2], corners[1], color);
@@ -145,15 +157,15 @@ namespace aruco
         }
     }
 
-    const cv::Point2f ArucoMarker::getMiddle() const
+    ArucoMarker::ArucoMarker(int id, const std::array<cv::Point2f, 4> &corners) : id(id), corners(corners)
     {
-        cv::Point2f ret;
         for (cv::Point2f i : corners) {
-            ret += i;
+            middle += i;
         }
-        ret.x /= corners.size();
-        ret.y /= corners.size();
-
-        return ret;
+        middle.x /= corners.size();
+        middle.y /= corners.size();
     }
+
+    ArucoMarker::ArucoMarker(int id, const std::vector<cv::Point2f> &corners)
+        : ArucoMarker(id, std::array<cv::Point2f, 4>{corners.at(0), corners.at(1), corners.at(2), corners.at(3)}) {}
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "aruco/aruco.hpp"
+#include "aruco/embeddedDictionary.hpp"
+
+namespace aruco
+{
+    cv::Ptr<cv::aruco::Dictionary> createEmbeddedDictionary(int correction)
+    {
+        // Header holds bytes in the layout of bytesList, the matrix only wraps them before copying
+        const cv::Mat bytes(embedded::MARKER_COUNT, embedded::BYTES_PER_ROTATION, CV_8UC4,
+                            const_cast<unsigned char *>(embedded::BYTES_LIST));
+
+        cv::Ptr<cv::aruco::Dictionary> arucoDictionary(new cv::aruco::Dictionary());
+        arucoDictionary->markerSize = embedded::MARKER_SIZE;
+        arucoDictionary->maxCorrectionBits = correction;
+        arucoDictionary->bytesList = bytes.clone();
+        return arucoDictionary;
+    }
+}
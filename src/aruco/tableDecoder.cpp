@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
+#include <string>
+
+#include "aruco/tableDecoder.hpp"
+
+namespace aruco
+{
+    TableMarkerDecoder::TableMarkerDecoder(cv::Ptr<cv::aruco::Dictionary> dictionary, const std::vector<int> &ids,
+                                           cv::Ptr<cv::aruco::DetectorParameters> parameters)
+        : markerSize(dictionary->markerSize),
+          maxCorrectionBits(static_cast<int>(dictionary->maxCorrectionBits * parameters->errorCorrectionRate)),
+          parameters(parameters)
+    {
+        if (markerSize * markerSize > 64)
+            throw std::runtime_error("Table decoder supports markers up to 8x8 bits, dictionary has " +
+                                     std::to_string(markerSize) + "x" + std::to_string(markerSize));
+
+        for (int id : ids)
+        {
+            if (id < 0 || id >= dictionary->bytesList.rows)
+                throw std::runtime_error("Marker " + std::to_string(id) + " is not in the dictionary");
+
+            cv::Mat bits = cv::aruco::Dictionary::getBitsFromByteList(dictionary->bytesList.rowRange(id, id + 1),
+                                                                       markerSize);
+            Code code = { id, { 0, 0, 0, 0 } };
+            for (int y = 0; y < markerSize; ++y)
+                for (int x = 0; x < markerSize; ++x)
+                    if (bits.at<unsigned char>(y, x))
+                        code.rotations[0] |= uint64_t(1) << (y * markerSize + x);
+
+            for (int rotation = 1; rotation < 4; ++rotation)
+                code.rotations[rotation] = rotateClockwise(code.rotations[rotation - 1], markerSize);
+            codes.push_back(code);
+        }
+    }
+
+    uint64_t TableMarkerDecoder::rotateClockwise(uint64_t code, int markerSize)
+    {
+        // Cell (y, x) of rotated marker comes from cell (n - 1 - x, y) of the original
+        uint64_t rotated = 0;
+        for (int y = 0; y < markerSize; ++y)
+            for (int x = 0; x < markerSize; ++x)
+                if (code & (uint64_t(1) << ((markerSize - 1 - x) * markerSize + y)))
+                    rotated |= uint64_t(1) << (y * markerSize + x);
+        return rotated;
+    }
+
+    // Samples cells of candidate seen through its corners, corners[0] is read as top left
+    bool TableMarkerDecoder::readCode(const cv::Mat &gray, const std::array<cv::Point2f, 4> &corners,
+                                      DetectionBuffers &buffers, uint64_t &code) const
+    {
+        const int border = parameters->markerBorderBits;
+        const int cells = markerSize + 2 * border;
+        const int cellSize = parameters->perspectiveRemovePixelPerCell;
+        const float side = static_cast<float>(cells * cellSize - 1);
+        const cv::Point2f square[4] = { { 0, 0 }, { side, 0 }, { side, side }, { 0, side } };
+
+        cv::warpPerspective(gray, buffers.warped, cv::getPerspectiveTransform(corners.data(), square),
+                            cv::Size(cells * cellSize, cells * cellSize), cv::INTER_NEAREST);
+
+        // Uniform patch has no black border and white bits to tell apart
+        cv::Scalar mean, deviation;
+        cv::meanStdDev(buffers.warped, mean, deviation);
+        if (deviation[0] < parameters->minOtsuStdDev)
+            return false;
+        cv::threshold(buffers.warped, buffers.warped, 125, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+        const int margin = static_cast<int>(cellSize * parameters->perspectiveRemoveIgnoredMarginPerCell);
+        const int inner = cellSize - 2 * margin;
+        const int maxBorderErrors =
+            static_cast<int>(markerSize * markerSize * parameters->maxErroneousBitsInBorderRate);
+
+        int borderErrors = 0;
+        code = 0;
+        for (int y = 0; y < cells; ++y)
+        {
+            for (int x = 0; x < cells; ++x)
+            {
+                const cv::Rect cell(x * cellSize + margin, y * cellSize + margin, inner, inner);
+                const bool white = cv::countNonZero(buffers.warped(cell)) * 2 > inner * inner;
+
+                if (y < border || x < border || y >= cells - border || x >= cells - border)
+                    borderErrors += white;
+                else if (white)
+                    code |= uint64_t(1) << ((y - border) * markerSize + (x - border));
+            }
+            if (borderErrors > maxBorderErrors)
+                return false;
+        }
+        return true;
+    }
+
+    // Returns number of differing bits to the closest marker rotation
+    int TableMarkerDecoder::identify(uint64_t code, int &index, int &rotation) const
+    {
+        int best = markerSize * markerSize + 1;
+        for (size_t i = 0; i < codes.size(); ++i)
+        {
+            for (int r = 0; r < 4; ++r)
+            {
+                const int distance = static_cast<int>(std::bitset<64>(code ^ codes[i].rotations[r]).count());
+                if (distance < best)
+                {
+                    best = distance;
+                    index = static_cast<int>(i);
+                    rotation = r;
+                }
+            }
+        }
+        return best;
+    }
+
+    void TableMarkerDecoder::detect(const cv::Mat &frame, std::vector<ArucoMarker> &found,
+                                    DetectionBuffers &buffers) const
+    {
+        found.clear();
+        buffers.scores.clear();
+
+        if (frame.channels() != 1)
+            cv::cvtColor(frame, buffers.gray, cv::COLOR_BGR2GRAY);
+        const cv::Mat &gray = frame.channels() == 1 ? frame : buffers.gray;
+
+        // Contour of a marker border has about as many points as its perimeter in pixels
+        const double maxDimension = std::max(gray.cols, gray.rows);
+        const double minPerimeter = parameters->minMarkerPerimeterRate * maxDimension;
+        const double maxPerimeter = parameters->maxMarkerPerimeterRate * maxDimension;
+        const float minDistance = static_cast<float>(parameters->minDistanceToBorder);
+
+        const int step = std::max(parameters->adaptiveThreshWinSizeStep, 1);
+        for (int window = parameters->adaptiveThreshWinSizeMin; window <= parameters->adaptiveThreshWinSizeMax;
+             window += step)
+        {
+            const int blockSize = std::max(window | 1, 3);
+            cv::adaptiveThreshold(gray, buffers.thresholded, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY_INV,
+                                  blockSize, parameters->adaptiveThreshConstant);
+            cv::findContours(buffers.thresholded, buffers.contours, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+
+            for (const std::vector<cv::Point> &contour : buffers.contours)
+            {
+                if (contour.size() < minPerimeter || contour.size() > maxPerimeter)
+                    continue;
+
+                cv::approxPolyDP(contour, buffers.polygon, contour.size() * parameters->polygonalApproxAccuracyRate,
+                                 true);
+                if (buffers.polygon.size() != 4 || !cv::isContourConvex(buffers.polygon))
+                    continue;
+
+                std::array<cv::Point2f, 4> corners;
+                double minSide = maxPerimeter * maxPerimeter;
+                bool nearBorder = false;
+                for (int i = 0; i < 4; ++i)
+                {
+                    const cv::Point side = buffers.polygon[i] - buffers.polygon[(i + 1) % 4];
+                    minSide = std::min(minSide, static_cast<double>(side.dot(side)));
+                    corners[i] = buffers.polygon[i];
+                    nearBorder |= corners[i].x < minDistance || corners[i].y < minDistance ||
+                                  corners[i].x > gray.cols - 1 - minDistance ||
+                                  corners[i].y > gray.rows - 1 - minDistance;
+                }
+                const double minSideLength = contour.size() * parameters->minCornerDistanceRate;
+                if (nearBorder || minSide < minSideLength * minSideLength)
+                    continue;
+
+                // Clockwise order in image coordinates
+                const cv::Point2f first = corners[1] - corners[0], second = corners[2] - corners[0];
+                if (first.x * second.y - first.y * second.x < 0)
+                    std::swap(corners[1], corners[3]);
+
+                uint64_t code;
+                if (!readCode(gray, corners, buffers, code))
+                    continue;
+
+                int index = 0, rotation = 0;
+                const int distance = identify(code, index, rotation);
+                if (distance > maxCorrectionBits)
+                    continue;
+
+                // Marker seen rotated clockwise by r has its top left corner at position r
+                std::rotate(corners.begin(), corners.begin() + rotation, corners.end());
+
+                const int id = codes[index].id;
+                const std::pair<int, size_t> score(distance, contour.size());
+                auto same = std::find_if(found.begin(), found.end(),
+                                         [id](const ArucoMarker &marker) { return marker.getId() == id; });
+                if (same == found.end())
+                {
+                    found.emplace_back(id, corners);
+                    buffers.scores.push_back(score);
+                }
+                else if (score.first < buffers.scores[same - found.begin()].first ||
+                         (score.first == buffers.scores[same - found.begin()].first &&
+                          score.second > buffers.scores[same - found.begin()].second))
+                {
+                    *same = ArucoMarker(id, corners);
+                    buffers.scores[same - found.begin()] = score;
+                }
+            }
+
+            // Other thresholds cannot do better than every marker read without errors
+            const bool allExact = std::all_of(buffers.scores.begin(), buffers.scores.end(),
+                                              [](const std::pair<int, size_t> &s) { return s.first == 0; });
+            if (found.size() == codes.size() && allExact)
+                break;
+        }
+
+        if (parameters->cornerRefinementMethod != cv::aruco::CORNER_REFINE_SUBPIX)
+            return;
+
+        const cv::Size window(parameters->cornerRefinementWinSize, parameters->cornerRefinementWinSize);
+        const cv::TermCriteria criteria(cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS,
+                                        parameters->cornerRefinementMaxIterations,
+                                        parameters->cornerRefinementMinAccuracy);
+        for (ArucoMarker &marker : found)
+        {
+            std::array<cv::Point2f, 4> corners = marker.getCorners();
+            cv::cornerSubPix(gray, corners, window, cv::Size(-1, -1), criteria);
+            marker = ArucoMarker(marker.getId(), corners);
+        }
+    }
+} // namespace aruco
@@ -0,0 +1,123 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "calib/calibrationCache.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace calibration
+{
+    static size_t mapBytes(const CacheHeader &header)
+    {
+        // Fixed-point map of two shorts per pixel and interpolation table index of one short
+        return size_t(header.mapWidth) * header.mapHeight * (2 * sizeof(int16_t) + sizeof(uint16_t));
+    }
+
+    uint64_t CalibrationCache::hashFile(const std::string &path)
+    {
+        const util::MappedFile source(path);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < source.getSize(); ++i)
+        {
+            hash ^= source.getData()[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    void CalibrationCache::write(const std::string &cachePath, uint64_t sourceHash, const cv::Mat &cameraMatrix,
+                                 const cv::Mat &distCoeffs, const cv::Mat &map1, const cv::Mat &map2,
+                                 bool fisheye)
+    {
+        CacheHeader header = {};
+        std::memcpy(header.magic, "FBCC", 4);
+        header.version = VERSION;
+        header.sourceHash = sourceHash;
+        header.flags = fisheye ? FISHEYE : 0;
+
+        cv::Mat camera, coefficients;
+        cameraMatrix.convertTo(camera, CV_64F);
+        if (!distCoeffs.empty())
+            distCoeffs.reshape(1, 1).convertTo(coefficients, CV_64F);
+        if (camera.total() != 9 || coefficients.total() > 14)
+            throw std::invalid_argument("Cannot cache calibration with unexpected matrix sizes");
+
+        std::memcpy(header.cameraMatrix, camera.ptr<double>(), sizeof(header.cameraMatrix));
+        header.distCoeffCount = static_cast<uint32_t>(coefficients.total());
+        if (!coefficients.empty())
+            std::memcpy(header.distCoeffs, coefficients.ptr<double>(), coefficients.total() * sizeof(double));
+
+        if (!map1.empty())
+        {
+            if (map1.type() != CV_16SC2 || map2.type() != CV_16UC1 || map1.size() != map2.size() ||
+                !map1.isContinuous() || !map2.isContinuous())
+                throw std::invalid_argument("Cannot cache undistortion maps of unexpected type");
+            header.mapWidth = map1.cols;
+            header.mapHeight = map1.rows;
+        }
+
+        // Other processes may write the same cache at once, each one renames its own complete file
+        const std::string temporaryPath = cachePath + "." + std::to_string(getpid()) + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            if (header.mapWidth > 0)
+            {
+                file.write(reinterpret_cast<const char *>(map1.data), map1.total() * map1.elemSize());
+                file.write(reinterpret_cast<const char *>(map2.data), map2.total() * map2.elemSize());
+            }
+            if (!file)
+                throw std::filesystem::filesystem_error(
+                    "Cannot write calibration cache " + cachePath,
+                    std::make_error_code(std::errc::io_error));
+        }
+        std::filesystem::rename(temporaryPath, cachePath);
+    }
+
+    CalibrationCache::CalibrationCache(const std::string &cachePath)
+        : file(std::make_shared<util::MappedFile>(cachePath))
+    {
+        header = reinterpret_cast<const CacheHeader *>(file->getData());
+
+        if (file->getSize() < sizeof(CacheHeader) || std::memcmp(header->magic, "FBCC", 4) != 0)
+            throw std::runtime_error("Not a calibration cache: " + cachePath);
+        if (header->version != VERSION)
+            throw std::runtime_error("Unsupported calibration cache version " +
+                                     std::to_string(header->version) + " in " + cachePath);
+        if (header->distCoeffCount > 14 || header->mapWidth < 0 || header->mapHeight < 0 ||
+            file->getSize() != sizeof(CacheHeader) + mapBytes(*header))
+            throw std::runtime_error("Truncated calibration cache: " + cachePath);
+    }
+
+    cv::Mat CalibrationCache::getCameraMatrix() const
+    {
+        return cv::Mat(3, 3, CV_64F, const_cast<double *>(header->cameraMatrix)).clone();
+    }
+
+    cv::Mat CalibrationCache::getDistCoeffs() const
+    {
+        // Same shape as distortion_coefficients read from XML
+        return cv::Mat(static_cast<int>(header->distCoeffCount), 1, CV_64F,
+                       const_cast<double *>(header->distCoeffs)).clone();
+    }
+
+    cv::Mat CalibrationCache::getMap1() const
+    {
+        return cv::Mat(header->mapHeight, header->mapWidth, CV_16SC2,
+                       const_cast<uint8_t *>(file->getData() + sizeof(CacheHeader)));
+    }
+
+    cv::Mat CalibrationCache::getMap2() const
+    {
+        const size_t map1Bytes = size_t(header->mapWidth) * header->mapHeight * 2 * sizeof(int16_t);
+        return cv::Mat(header->mapHeight, header->mapWidth, CV_16UC1,
+                       const_cast<uint8_t *>(file->getData() + sizeof(CacheHeader) + map1Bytes));
+    }
+} // namespace calibration
@@ -1,4 +1,15 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+
+#include "calib/calibrationCache.hpp"
 #include "calib/cameraCalibration.hpp"
+#include "util/threadPool.hpp"
 
 using namespace std;
 using namespace calibration;
@@ -25,6 +36,13 @@ void Settings::write(cv::FileStorage& fs) const
        << "Input_Delay" << delay
        << "Input_Skip" << skip
        << "Input" << input
+       << "Input_Parallel" << parallelDetection
+       << "Input_MinSharpness" << minSharpness
+       << "Input_SearchWidth" << searchWidth
+       << "Calibrate_MaxViews" << maxViews
+       << "Calibrate_OutlierRatio" << outlierRatio
+       << "Calibrate_SearchModel" << searchModel
+       << "Calibrate_Convergence" << convergence
        << "}";
 }
 
@@ -52,6 +70,13 @@ void Settings::read(const cv::FileNode& node)
     node["Fix_K3"] >> fixK3;
     node["Fix_K4"] >> fixK4;
     node["Fix_K5"] >> fixK5;
+    node["Input_Parallel"] >> parallelDetection;
+    node["Input_MinSharpness"] >> minSharpness;
+    node["Input_SearchWidth"] >> searchWidth;
+    node["Calibrate_MaxViews"] >> maxViews;
+    node["Calibrate_OutlierRatio"] >> outlierRatio;
+    node["Calibrate_SearchModel"] >> searchModel;
+    node["Calibrate_Convergence"] >> convergence;
     validate();
 }
 
@@ -223,9 +248,32 @@ bool CameraCalibration::init()
         return false;
     }
 
+    if (s.parallelDetection && (s.inputType == Settings::IMAGE_LIST || s.inputType == Settings::VIDEO_FILE))
+    {
+        vector<vector<cv::Point2f>> imagePoints;
+        cv::Size imageSize;
+        collectViews(s, imageSize, imagePoints);
+        cout << "Pattern found on " << imagePoints.size() << " views" << endl;
+
+        if (imagePoints.empty() || !runCalibrationAndSave(s, imageSize, cameraMatrix, distCoeffs, imagePoints))
+            return false;
+
+        std::lock_guard<std::mutex> lock(mapsMutex);
+        undistortMaps.clear();
+        calibrationHash = 0;
+        return true;
+    }
+
     vector<vector<cv::Point2f>> imagePoints;
     cv::Size imageSize;
     int mode = s.inputType == Settings::IMAGE_LIST ? CAPTURING : DETECTION;
+
+    // Running solution of incremental mode, capture stops after it stays still for a few views
+    const size_t MIN_REFINE_VIEWS = 3;
+    const int CONVERGED_VIEWS = 3;
+    cv::Mat runningCamera, runningDist;
+    double runningError = 0;
+    int stableViews = 0;
     clock_t prevTimestamp = 0;
     const cv::Scalar RED(0,0,255), GREEN(0,255,0);
     const char ESC_KEY = 27;
@@ -238,8 +286,10 @@ bool CameraCalibration::init()
         view = s.nextImage();
 
         //-----  If no more image, or got enough, then stop calibration and show result -------------
-        if( mode == CAPTURING && imagePoints.size() >= (size_t)s.nrFrames )
+        if( mode == CAPTURING && (imagePoints.size() >= (size_t)s.nrFrames || stableViews >= CONVERGED_VIEWS) )
         {
+            if (stableViews >= CONVERGED_VIEWS)
+                cout << "Calibration converged after " << imagePoints.size() << " views" << endl;
             if( runCalibrationAndSave(s, imageSize,  cameraMatrix, distCoeffs, imagePoints))
                 mode = CALIBRATED;
             else
@@ -260,50 +310,36 @@ bool CameraCalibration::init()
         //! [find_pattern]
         vector<cv::Point2f> pointBuf;
 
-        bool found;
-
-        int chessBoardFlags = cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE;
-
-        if(!s.useFisheye)
-        {
-            // fast check erroneously fails with high distortions like fisheye
-            chessBoardFlags |= cv::CALIB_CB_FAST_CHECK;
-        }
-
-        switch( s.calibrationPattern ) // Find feature points on the input format
-        {
-        case Settings::CHESSBOARD:
-            found = findChessboardCorners( view, s.boardSize, pointBuf, chessBoardFlags);
-            break;
-        case Settings::CIRCLES_GRID:
-            found = findCirclesGrid( view, s.boardSize, pointBuf );
-            break;
-        case Settings::ASYMMETRIC_CIRCLES_GRID:
-            found = findCirclesGrid( view, s.boardSize, pointBuf, cv::CALIB_CB_ASYMMETRIC_GRID );
-            break;
-        default:
-            found = false;
-            break;
-        }
+        bool found = findPattern(s, view, pointBuf);
         //! [find_pattern]
         //! [pattern_found]
         if ( found)                // If done with success,
         {
-            // improve the found corners' coordinate accuracy for chessboard
-            if( s.calibrationPattern == Settings::CHESSBOARD)
-            {
-                cv::Mat viewGray;
-                cvtColor(view, viewGray, cv::COLOR_BGR2GRAY);
-                cornerSubPix( viewGray, pointBuf, cv::Size(11,11), cv::Size(-1,-1),
-                              cv::TermCriteria(cv::TermCriteria::EPS+ cv::TermCriteria::COUNT, 30, 0.1 ));
-            }
-
             if( mode == CAPTURING &&  // For camera only take new samples after delay time
                     (!s.inputCapture.isOpened() || clock() - prevTimestamp > s.delay*1e-3*CLOCKS_PER_SEC))
             {
                 imagePoints.push_back(pointBuf);
                 prevTimestamp = clock();
                 blinkOutput = s.inputCapture.isOpened();
+
+                if (s.convergence > 0 && imagePoints.size() >= MIN_REFINE_VIEWS)
+                {
+                    const cv::Mat previous = runningCamera.clone();
+                    try
+                    {
+                        runningError = refine(s, imageSize, imagePoints, runningCamera, runningDist);
+                        stableViews = !previous.empty() &&
+                            intrinsicsChange(previous, runningCamera) < s.convergence ? stableViews + 1 : 0;
+                    }
+                    catch (const cv::Exception& e)
+                    {
+                        // Poor first views, next one starts from scratch
+                        runningCamera.release();
+                        runningDist.release();
+                        runningError = 0;
+                        stableViews = 0;
+                    }
+                }
             }
 
             // Draw the corners.
@@ -324,6 +360,8 @@ bool CameraCalibration::init()
                 msg = cv::format( "%d/%d Undist", (int)imagePoints.size(), s.nrFrames );
             else
                 msg = cv::format( "%d/%d", (int)imagePoints.size(), s.nrFrames );
+            if( runningError > 0 )
+                msg += cv::format( " err %.3f", runningError );
         }
 
         putText( view, msg, textOrigin, 1, 1, mode == CALIBRATED ?  GREEN : RED);
@@ -339,7 +377,7 @@ bool CameraCalibration::init()
             if (s.useFisheye)
                 cv::fisheye::undistortImage(temp, view, cameraMatrix, distCoeffs);
             else
-                undistort(temp, view, cameraMatrix, distCoeffs);
+                cv::undistort(temp, view, cameraMatrix, distCoeffs);
         }
         //! [output_undistorted]
         //------------------------------ Show image and check for input commands ------------------
@@ -357,6 +395,10 @@ bool CameraCalibration::init()
         {
             mode = CAPTURING;
             imagePoints.clear();
+            runningCamera.release();
+            runningDist.release();
+            runningError = 0;
+            stableViews = 0;
         }
         //! [await_input]
     }
@@ -397,9 +439,175 @@ bool CameraCalibration::init()
     }
     //! [show_results]
 
+    // New parameters do not match the calibration file anymore, so they are not cached
+    std::lock_guard<std::mutex> lock(mapsMutex);
+    undistortMaps.clear();
+    calibrationHash = 0;
+    return true;
+}
+
+static bool searchPattern(const Settings& s, const cv::Mat& image, vector<cv::Point2f>& pointBuf)
+{
+    int chessBoardFlags = cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE;
+
+    if(!s.useFisheye)
+    {
+        // fast check erroneously fails with high distortions like fisheye
+        chessBoardFlags |= cv::CALIB_CB_FAST_CHECK;
+    }
+
+    switch( s.calibrationPattern ) // Find feature points on the input format
+    {
+    case Settings::CHESSBOARD:
+        return findChessboardCorners( image, s.boardSize, pointBuf, chessBoardFlags);
+    case Settings::CIRCLES_GRID:
+        return findCirclesGrid( image, s.boardSize, pointBuf );
+    case Settings::ASYMMETRIC_CIRCLES_GRID:
+        return findCirclesGrid( image, s.boardSize, pointBuf, cv::CALIB_CB_ASYMMETRIC_GRID );
+    default:
+        return false;
+    }
+}
+
+bool CameraCalibration::findPattern(const Settings& s, const cv::Mat& view, vector<cv::Point2f>& pointBuf)
+{
+    cv::Mat viewGray;
+    cvtColor(view, viewGray, cv::COLOR_BGR2GRAY);
+
+    // Search on downscaled view is much faster, points are refined on full resolution afterwards
+    const double scale = s.searchWidth > 0 && viewGray.cols > s.searchWidth ?
+                         (double)viewGray.cols / s.searchWidth : 1.0;
+    if (scale == 1.0)
+    {
+        if (!searchPattern(s, viewGray, pointBuf))
+            return false;
+    }
+    else
+    {
+        cv::Mat smallGray;
+        resize(viewGray, smallGray, cv::Size(), 1.0 / scale, 1.0 / scale, cv::INTER_AREA);
+        if (!searchPattern(s, smallGray, pointBuf))
+            return false;
+
+        // Pixel centers of the small image map to centers of scale x scale blocks
+        for (cv::Point2f& point : pointBuf)
+            point = cv::Point2f((float)((point.x + 0.5) * scale - 0.5), (float)((point.y + 0.5) * scale - 0.5));
+    }
+
+    // improve the found corners' coordinate accuracy for chessboard
+    if( s.calibrationPattern == Settings::CHESSBOARD)
+    {
+        // Window must cover the error left by upscaling
+        const int window = std::max(11, (int)std::ceil(2 * scale));
+        cornerSubPix( viewGray, pointBuf, cv::Size(window, window), cv::Size(-1,-1),
+                      cv::TermCriteria(cv::TermCriteria::EPS+ cv::TermCriteria::COUNT, 30, 0.1 ));
+    }
+    else if (scale != 1.0)
+    {
+        // Circle centers are not corners, they are found again at full resolution around the coarse grid
+        const double spacing = norm(pointBuf[1] - pointBuf[0]);
+        const int margin = (int)std::ceil(spacing + 4 * scale);
+        cv::Rect area = boundingRect(pointBuf);
+        area = cv::Rect(area.x - margin, area.y - margin, area.width + 2 * margin, area.height + 2 * margin) &
+               cv::Rect(0, 0, viewGray.cols, viewGray.rows);
+
+        // Coarse points are kept when the grid is not found again in the same order
+        vector<cv::Point2f> refined;
+        if (searchPattern(s, viewGray(area), refined))
+        {
+            bool sameOrder = true;
+            for (size_t i = 0; i < refined.size(); ++i)
+            {
+                refined[i] += cv::Point2f((float)area.x, (float)area.y);
+                sameOrder &= norm(refined[i] - pointBuf[i]) < spacing / 2;
+            }
+            if (sameOrder)
+                pointBuf = refined;
+        }
+    }
     return true;
 }
 
+double CameraCalibration::sharpness(const cv::Mat& view)
+{
+    cv::Mat gray, small, laplacian;
+    cvtColor(view, gray, cv::COLOR_BGR2GRAY);
+    resize(gray, small, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    Laplacian(small, laplacian, CV_16S);
+
+    cv::Scalar mean, deviation;
+    meanStdDev(laplacian, mean, deviation);
+    return deviation[0] * deviation[0];
+}
+
+void CameraCalibration::collectViews(Settings& s, cv::Size& imageSize, vector<vector<cv::Point2f>>& imagePoints)
+{
+    struct View
+    {
+        cv::Size size;
+        bool found = false;
+        vector<cv::Point2f> points;
+    };
+
+    // Views are loaded and searched by the pool, but taken in input order, so result does not depend on timing
+    util::ThreadPool pool;
+    const size_t maxInFlight = 2 * pool.size();
+    std::deque<std::future<View>> pending;
+    bool exhausted = false;
+
+    auto detect = [&s](cv::Mat view) -> View {
+        View result;
+        result.size = view.size();
+        if (view.empty() || (s.minSharpness > 0 && sharpness(view) < s.minSharpness))
+            return result;
+        if (s.flipVertical)
+            flip(view, view, 0);
+        result.found = findPattern(s, view, result.points);
+        return result;
+    };
+
+    while (imagePoints.size() < (size_t)s.nrFrames)
+    {
+        while (!exhausted && pending.size() < maxInFlight)
+        {
+            if (s.inputType == Settings::IMAGE_LIST)
+            {
+                if (s.atImageList + s.skip >= s.imageList.size())
+                {
+                    exhausted = true;
+                    break;
+                }
+                const string path = s.imageList[s.atImageList += s.skip];
+                pending.push_back(pool.submit([path, detect]() { return detect(cv::imread(path, cv::IMREAD_COLOR)); }));
+            }
+            else
+            {
+                // Neighbouring frames of a video show the same pose, only every skip-th one is decoded
+                cv::Mat view;
+                s.inputCapture >> view;
+                for (int i = 1; i < s.skip && !view.empty(); ++i)
+                    s.inputCapture.grab();
+                if (view.empty())
+                {
+                    exhausted = true;
+                    break;
+                }
+                pending.push_back(pool.submit([view, detect]() { return detect(view); }));
+            }
+        }
+        if (pending.empty())
+            break;
+
+        View view = pending.front().get();
+        pending.pop_front();
+        if (view.found)
+        {
+            imageSize = view.size;
+            imagePoints.push_back(std::move(view.points));
+        }
+    }
+}
+
 //! [compute_errors]
 double CameraCalibration::computeReprojectionErrors( const vector<vector<cv::Point3f> >&
         objectPoints,
@@ -467,33 +675,61 @@ bool CameraCalibration::runCalibration( Settings& s, cv::Size& imageSize, cv::Ma
                                         vector<float>& reprojErrs,
                                         double& totalAvgErr)
 {
-    //! [fixed_aspect]
-    cameraMatrix = cv::Mat::eye(3, 3, CV_64F);
-    if( s.flag & cv::CALIB_FIX_ASPECT_RATIO )
-        cameraMatrix.at<double>(0,0) = s.aspectRatio;
-    //! [fixed_aspect]
-    if (s.useFisheye)
-    {
-        distCoeffs = cv::Mat::zeros(4, 1, CV_64F);
-    }
-    else
-    {
-        distCoeffs = cv::Mat::zeros(8, 1, CV_64F);
-    }
-
     vector<vector<cv::Point3f> > objectPoints(1);
     calcBoardCornerPositions(s.boardSize, s.squareSize, objectPoints[0], s.calibrationPattern);
 
     objectPoints.resize(imagePoints.size(),objectPoints[0]);
 
     //Find intrinsic and extrinsic camera parameters
+    double rms = solve(s, imageSize, objectPoints, imagePoints, cameraMatrix, distCoeffs, rvecs, tvecs);
+
+    cout << "Re-projection error reported by calibrateCamera: "<< rms << endl;
+
+    bool ok = checkRange(cameraMatrix) && checkRange(distCoeffs);
+
+    totalAvgErr = computeReprojectionErrors(objectPoints, imagePoints, rvecs, tvecs, cameraMatrix,
+                                            distCoeffs, reprojErrs, s.useFisheye);
+
+    return ok;
+}
+
+double CameraCalibration::solve(const Settings& s, const cv::Size& imageSize,
+                                const vector<vector<cv::Point3f> >& objectPoints,
+                                const vector<vector<cv::Point2f> >& imagePoints,
+                                cv::Mat& cameraMatrix, cv::Mat& distCoeffs,
+                                vector<cv::Mat>& rvecs, vector<cv::Mat>& tvecs, bool useGuess)
+{
     double rms;
+    int flag = s.flag;
+    rvecs.clear();
+    tvecs.clear();
+
+    if (useGuess)
+    {
+        flag |= s.useFisheye ? (int)cv::fisheye::CALIB_USE_INTRINSIC_GUESS : (int)cv::CALIB_USE_INTRINSIC_GUESS;
+    }
+    else
+    {
+        //! [fixed_aspect]
+        cameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+        if( s.flag & cv::CALIB_FIX_ASPECT_RATIO )
+            cameraMatrix.at<double>(0,0) = s.aspectRatio;
+        //! [fixed_aspect]
+        if (s.useFisheye)
+        {
+            distCoeffs = cv::Mat::zeros(4, 1, CV_64F);
+        }
+        else
+        {
+            distCoeffs = cv::Mat::zeros(s.flag & cv::CALIB_THIN_PRISM_MODEL ? 12 : 8, 1, CV_64F);
+        }
+    }
 
     if (s.useFisheye)
     {
         cv::Mat _rvecs, _tvecs;
         rms = cv::fisheye::calibrate(objectPoints, imagePoints, imageSize, cameraMatrix, distCoeffs, _rvecs,
-                                     _tvecs, s.flag);
+                                     _tvecs, flag);
 
         rvecs.reserve(_rvecs.rows);
         tvecs.reserve(_tvecs.rows);
@@ -506,17 +742,313 @@ bool CameraCalibration::runCalibration( Settings& s, cv::Size& imageSize, cv::Ma
     else
     {
         rms = calibrateCamera(objectPoints, imagePoints, imageSize, cameraMatrix, distCoeffs, rvecs, tvecs,
-                              s.flag);
+                              flag);
     }
+    return rms;
+}
 
-    cout << "Re-projection error reported by calibrateCamera: "<< rms << endl;
+double CameraCalibration::refine(const Settings& s, const cv::Size& imageSize,
+                                 const vector<vector<cv::Point2f> >& imagePoints,
+                                 cv::Mat& cameraMatrix, cv::Mat& distCoeffs)
+{
+    vector<cv::Point3f> board;
+    calcBoardCornerPositions(s.boardSize, s.squareSize, board, s.calibrationPattern);
 
-    bool ok = checkRange(cameraMatrix) && checkRange(distCoeffs);
+    // Previous estimate is close, so solver needs a few iterations instead of a full solve
+    vector<cv::Mat> rvecs, tvecs;
+    return solve(s, imageSize, vector<vector<cv::Point3f> >(imagePoints.size(), board), imagePoints,
+                 cameraMatrix, distCoeffs, rvecs, tvecs, !cameraMatrix.empty());
+}
 
-    totalAvgErr = computeReprojectionErrors(objectPoints, imagePoints, rvecs, tvecs, cameraMatrix,
-                                            distCoeffs, reprojErrs, s.useFisheye);
+double CameraCalibration::intrinsicsChange(const cv::Mat& previous, const cv::Mat& next)
+{
+    auto at = [](const cv::Mat& m, int row, int col) { return m.at<double>(row, col); };
+    const double scale = std::max(std::abs(at(previous, 0, 0)), std::abs(at(previous, 1, 1)));
+    return std::max({ std::abs(at(next, 0, 0) - at(previous, 0, 0)) / std::abs(at(previous, 0, 0)),
+                      std::abs(at(next, 1, 1) - at(previous, 1, 1)) / std::abs(at(previous, 1, 1)),
+                      std::abs(at(next, 0, 2) - at(previous, 0, 2)) / scale,
+                      std::abs(at(next, 1, 2) - at(previous, 1, 2)) / scale });
+}
 
-    return ok;
+void CameraCalibration::selectViews(const Settings& s, const cv::Size& imageSize,
+                                    vector<vector<cv::Point2f> >& imagePoints)
+{
+    if (s.maxViews <= 0 || imagePoints.size() <= (size_t)s.maxViews)
+        return;
+
+    // Outer points of the pattern tell where it is, how big it is and how it is tilted towards camera
+    const int width = s.boardSize.width, height = s.boardSize.height;
+    vector<std::array<double, 7>> descriptors;
+    for (const vector<cv::Point2f>& points : imagePoints)
+    {
+        const cv::Point2f a = points[0], b = points[width - 1], c = points[width * (height - 1)], d = points.back();
+        const cv::Point2f center = (a + b + c + d) * 0.25f;
+        const vector<cv::Point2f> outline = { a, b, d, c };
+        const double angle = std::atan2(b.y - a.y, b.x - a.x);
+
+        descriptors.push_back({ center.x / imageSize.width, center.y / imageSize.height,
+                                std::sqrt(std::abs(contourArea(outline)) / imageSize.area()),
+                                std::log(norm(b - a) / norm(d - c)), std::log(norm(c - a) / norm(d - b)),
+                                0.5 * std::cos(angle), 0.5 * std::sin(angle) });
+    }
+
+    auto distance = [&descriptors](size_t i, size_t j) {
+        double sum = 0;
+        for (size_t k = 0; k < descriptors[i].size(); ++k)
+            sum += (descriptors[i][k] - descriptors[j][k]) * (descriptors[i][k] - descriptors[j][k]);
+        return sum;
+    };
+
+    // Farthest point sampling, starting with the largest view
+    size_t next = 0;
+    for (size_t i = 1; i < descriptors.size(); ++i)
+        if (descriptors[i][2] > descriptors[next][2])
+            next = i;
+
+    vector<size_t> selected;
+    vector<double> nearest(descriptors.size(), std::numeric_limits<double>::max());
+    while (selected.size() < (size_t)s.maxViews)
+    {
+        selected.push_back(next);
+        for (size_t i = 0; i < descriptors.size(); ++i)
+            nearest[i] = std::min(nearest[i], distance(i, next));
+        // Duplicate views have zero distance too, selected ones must never win again
+        nearest[next] = -1;
+        next = std::max_element(nearest.begin(), nearest.end()) - nearest.begin();
+    }
+
+    std::sort(selected.begin(), selected.end());
+    vector<vector<cv::Point2f> > views;
+    for (size_t i : selected)
+        views.push_back(std::move(imagePoints[i]));
+
+    cout << "Selected " << views.size() << " of " << imagePoints.size() << " views" << endl;
+    imagePoints = std::move(views);
+}
+
+void CameraCalibration::rejectOutlierViews(const Settings& s, const cv::Size& imageSize,
+                                           vector<vector<cv::Point2f> >& imagePoints)
+{
+    if (s.outlierRatio <= 0)
+        return;
+
+    vector<cv::Point3f> board;
+    calcBoardCornerPositions(s.boardSize, s.squareSize, board, s.calibrationPattern);
+
+    auto evaluate = [&s, &imageSize, &board](const vector<vector<cv::Point2f> >& views, vector<float>& errors) {
+        const vector<vector<cv::Point3f> > objectPoints(views.size(), board);
+        cv::Mat cameraMatrix, distCoeffs;
+        vector<cv::Mat> rvecs, tvecs;
+        solve(s, imageSize, objectPoints, views, cameraMatrix, distCoeffs, rvecs, tvecs);
+        return computeReprojectionErrors(objectPoints, views, rvecs, tvecs, cameraMatrix, distCoeffs, errors,
+                                         s.useFisheye);
+    };
+
+    // At most a third of views is dropped, so the rest still constrains the model
+    const size_t minViews = std::max<size_t>(4, (imagePoints.size() * 2 + 2) / 3);
+    util::ThreadPool pool;
+    vector<float> errors;
+    double error = evaluate(imagePoints, errors);
+
+    while (imagePoints.size() > minViews)
+    {
+        vector<float> sorted = errors;
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        const float limit = s.outlierRatio * sorted[sorted.size() / 2];
+
+        vector<size_t> candidates;
+        vector<std::future<double>> results;
+        for (size_t i = 0; i < errors.size(); ++i)
+        {
+            if (errors[i] <= limit)
+                continue;
+            candidates.push_back(i);
+            results.push_back(pool.submit([&imagePoints, &evaluate, i]() {
+                vector<vector<cv::Point2f> > views = imagePoints;
+                views.erase(views.begin() + i);
+                vector<float> viewErrors;
+                try
+                {
+                    return evaluate(views, viewErrors);
+                }
+                catch (const cv::Exception&)
+                {
+                    // Solver can fail on degenerate subsets, such candidate is simply not chosen
+                    return std::numeric_limits<double>::max();
+                }
+            }));
+        }
+        if (candidates.empty())
+            break;
+
+        // Ties are broken by view order, so result does not depend on thread timing
+        size_t best = 0;
+        double bestError = std::numeric_limits<double>::max();
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const double candidateError = results[i].get();
+            if (candidateError < bestError)
+            {
+                bestError = candidateError;
+                best = candidates[i];
+            }
+        }
+        if (bestError >= error)
+            break;
+
+        cout << "Dropping view " << best << " with error " << errors[best] << ", average error "
+             << error << " -> " << bestError << endl;
+        imagePoints.erase(imagePoints.begin() + best);
+        error = evaluate(imagePoints, errors);
+    }
+}
+
+void CameraCalibration::searchModel(Settings& s, const cv::Size& imageSize,
+                                    const vector<vector<cv::Point2f> >& imagePoints)
+{
+    // Each view is held out once, so models are compared on views they were not fitted to
+    const int folds = (int)std::min<size_t>(5, imagePoints.size());
+    if (folds < 4)
+    {
+        cerr << "Too few views to compare calibration models, using configured one" << endl;
+        return;
+    }
+
+    // Constraints chosen in settings are kept, only the distortion model changes
+    int pinhole = 0, fisheyeFlags = cv::fisheye::CALIB_FIX_SKEW | cv::fisheye::CALIB_RECOMPUTE_EXTRINSIC;
+    if (s.calibFixPrincipalPoint)
+    {
+        pinhole |= cv::CALIB_FIX_PRINCIPAL_POINT;
+        fisheyeFlags |= cv::fisheye::CALIB_FIX_PRINCIPAL_POINT;
+    }
+    if (s.calibZeroTangentDist) pinhole |= cv::CALIB_ZERO_TANGENT_DIST;
+    if (s.aspectRatio)          pinhole |= cv::CALIB_FIX_ASPECT_RATIO;
+
+    struct Model
+    {
+        string name;
+        bool fisheye;
+        int flag;
+        double trainError, heldOutError;
+    };
+    vector<Model> models = {
+        { "pinhole-5", false, pinhole, 0, 0 },
+        { "rational-8", false, pinhole | cv::CALIB_RATIONAL_MODEL, 0, 0 },
+        { "thin-prism-12", false, pinhole | cv::CALIB_RATIONAL_MODEL | cv::CALIB_THIN_PRISM_MODEL, 0, 0 },
+        { "fisheye-4", true, fisheyeFlags, 0, 0 },
+    };
+
+    vector<cv::Point3f> board;
+    calcBoardCornerPositions(s.boardSize, s.squareSize, board, s.calibrationPattern);
+
+    // Sum of squared held-out errors and number of points of one fold
+    auto evaluateFold = [&imagePoints, &imageSize, &board](const Settings& model, int fold, int folds) {
+        vector<vector<cv::Point2f> > train, test;
+        for (size_t i = 0; i < imagePoints.size(); ++i)
+            (i % folds == (size_t)fold ? test : train).push_back(imagePoints[i]);
+
+        cv::Mat cameraMatrix, distCoeffs;
+        vector<cv::Mat> rvecs, tvecs;
+        solve(model, imageSize, vector<vector<cv::Point3f> >(train.size(), board), train, cameraMatrix, distCoeffs,
+              rvecs, tvecs);
+
+        std::pair<double, size_t> error(0.0, 0);
+        for (const vector<cv::Point2f>& view : test)
+        {
+            // Pose of held-out view is found with the fitted intrinsics
+            cv::Mat rvec, tvec;
+            vector<cv::Point2f> projected;
+            if (model.useFisheye)
+            {
+                vector<cv::Point2f> normalized;
+                cv::fisheye::undistortPoints(view, normalized, cameraMatrix, distCoeffs);
+                solvePnP(board, normalized, cv::Mat::eye(3, 3, CV_64F), cv::noArray(), rvec, tvec);
+                cv::fisheye::projectPoints(board, projected, rvec, tvec, cameraMatrix, distCoeffs);
+            }
+            else
+            {
+                solvePnP(board, view, cameraMatrix, distCoeffs, rvec, tvec);
+                projectPoints(board, rvec, tvec, cameraMatrix, distCoeffs, projected);
+            }
+            const double viewError = norm(view, projected, cv::NORM_L2);
+            error.first += viewError * viewError;
+            error.second += view.size();
+        }
+        return error;
+    };
+
+    vector<Settings> candidates(models.size(), s);
+    for (size_t m = 0; m < models.size(); ++m)
+    {
+        candidates[m].useFisheye = models[m].fisheye;
+        candidates[m].flag = models[m].flag;
+    }
+
+    util::ThreadPool pool;
+    vector<vector<std::future<std::pair<double, size_t> > > > foldResults(models.size());
+    vector<std::future<double> > trainResults;
+    for (size_t m = 0; m < models.size(); ++m)
+    {
+        const Settings& candidate = candidates[m];
+        trainResults.push_back(pool.submit([&candidate, &imagePoints, &imageSize, &board]() {
+            const vector<vector<cv::Point3f> > objectPoints(imagePoints.size(), board);
+            cv::Mat cameraMatrix, distCoeffs;
+            vector<cv::Mat> rvecs, tvecs;
+            vector<float> errors;
+            solve(candidate, imageSize, objectPoints, imagePoints, cameraMatrix, distCoeffs, rvecs, tvecs);
+            return computeReprojectionErrors(objectPoints, imagePoints, rvecs, tvecs, cameraMatrix, distCoeffs,
+                                             errors, candidate.useFisheye);
+        }));
+        for (int fold = 0; fold < folds; ++fold)
+            foldResults[m].push_back(pool.submit([&candidate, &evaluateFold, fold, folds]() {
+                return evaluateFold(candidate, fold, folds);
+            }));
+    }
+
+    // A model whose solver fails on some fold is not chosen
+    size_t best = 0;
+    for (size_t m = 0; m < models.size(); ++m)
+    {
+        try
+        {
+            models[m].trainError = trainResults[m].get();
+            double sum = 0;
+            size_t count = 0;
+            for (auto& result : foldResults[m])
+            {
+                const std::pair<double, size_t> error = result.get();
+                sum += error.first;
+                count += error.second;
+            }
+            models[m].heldOutError = std::sqrt(sum / count);
+        }
+        catch (const cv::Exception& e)
+        {
+            models[m].trainError = models[m].heldOutError = std::numeric_limits<double>::infinity();
+            for (auto& result : foldResults[m])
+                if (result.valid())
+                    result.wait();
+        }
+        if (models[m].heldOutError < models[best].heldOutError)
+            best = m;
+    }
+
+    // Comparison is written next to the calibration result
+    const string reportPath = s.outputFileName + ".models.csv";
+    std::ofstream report(reportPath);
+    report << "model,flags,train_error,held_out_error,chosen" << endl;
+    for (size_t m = 0; m < models.size(); ++m)
+    {
+        report << models[m].name << "," << models[m].flag << "," << models[m].trainError << ","
+               << models[m].heldOutError << "," << (m == best ? 1 : 0) << endl;
+        cout << "Model " << models[m].name << ": error " << models[m].trainError << ", held-out error "
+             << models[m].heldOutError << (m == best ? " (chosen)" : "") << endl;
+    }
+    if (!report)
+        cerr << "Could not write model comparison to " << reportPath << endl;
+
+    s.useFisheye = models[best].fisheye;
+    s.flag = models[best].flag;
 }
 
 // Print camera parameters to the output file
@@ -572,7 +1104,9 @@ void CameraCalibration::saveCameraParams( Settings& s, cv::Size& imageSize, cv::
                               << (s.flag & cv::CALIB_FIX_K2 ? " +fix_k2" : "")
                               << (s.flag & cv::CALIB_FIX_K3 ? " +fix_k3" : "")
                               << (s.flag & cv::CALIB_FIX_K4 ? " +fix_k4" : "")
-                              << (s.flag & cv::CALIB_FIX_K5 ? " +fix_k5" : "");
+                              << (s.flag & cv::CALIB_FIX_K5 ? " +fix_k5" : "")
+                              << (s.flag & cv::CALIB_RATIONAL_MODEL ? " +rational_model" : "")
+                              << (s.flag & cv::CALIB_THIN_PRISM_MODEL ? " +thin_prism_model" : "");
         }
         fs.writeComment(flagsStringStream.str());
     }
@@ -643,6 +1177,11 @@ bool CameraCalibration::runCalibrationAndSave(Settings& s, cv::Size imageSize,
     vector<float> reprojErrs;
     double totalAvgErr = 0;
 
+    selectViews(s, imageSize, imagePoints);
+    if (s.searchModel)
+        searchModel(s, imageSize, imagePoints);
+    rejectOutlierViews(s, imageSize, imagePoints);
+
     bool ok = runCalibration(s, imageSize, cameraMatrix, distCoeffs, imagePoints, rvecs, tvecs,
                              reprojErrs,
                              totalAvgErr);
@@ -650,24 +1189,214 @@ bool CameraCalibration::runCalibrationAndSave(Settings& s, cv::Size imageSize,
          << ". avg re projection error = " << totalAvgErr << endl;
 
     if (ok)
+    {
+        fisheye = s.useFisheye;
         saveCameraParams(s, imageSize, cameraMatrix, distCoeffs, rvecs, tvecs, reprojErrs,
                          imagePoints, totalAvgErr);
+    }
     return ok;
 }
 //! [run_and_save]
 
-cv::Mat CameraCalibration::getUndistortedImage(cv::Mat distortedImage)
+cv::Mat CameraCalibration::getUndistortedImage(cv::Mat distortedImage) const
 {
     cv::Mat view;
-	undistort(distortedImage, view, cameraMatrix, distCoeffs);
+    undistort(distortedImage, view);
     return view;
 }
 
+uint64_t CameraCalibration::undistort(const cv::Mat &distortedImage, cv::Mat &undistortedImage) const
+{
+    uint64_t generation;
+    auto maps = getUndistortMaps(distortedImage.size(), generation);
+    remap(distortedImage, undistortedImage, maps->map1, maps->map2, cv::INTER_LINEAR);
+    return generation;
+}
+
+std::shared_ptr<const CameraCalibration::UndistortMaps> CameraCalibration::getUndistortMaps(cv::Size imageSize,
+                                                                                            uint64_t &generation) const
+{
+    std::shared_ptr<const UndistortMaps> newMaps;
+    uint64_t hash;
+    cv::Mat cachedCamera, cachedDist;
+    bool cachedFisheye;
+    {
+        std::lock_guard<std::mutex> lock(mapsMutex);
+        generation = this->generation;
+        auto &maps = undistortMaps[{ imageSize.width, imageSize.height }];
+        if (maps)
+            return maps;
+
+        maps = computeUndistortMaps(cameraMatrix, distCoeffs, fisheye, imageSize);
+        if (!calibrationHash || cacheHasMaps)
+            return maps;
+
+        // Parameters are replaced by new matrices on swap, so these headers keep the written ones
+        cacheHasMaps = true;
+        newMaps = maps;
+        hash = calibrationHash;
+        cachedCamera = cameraMatrix;
+        cachedDist = distCoeffs;
+        cachedFisheye = fisheye;
+    }
+
+    // Maps of a large frame take megabytes, other threads keep undistorting while they are written
+    try
+    {
+        CalibrationCache::write(CalibrationCache::defaultPath(calibrationFileName), hash,
+                                cachedCamera, cachedDist, newMaps->map1, newMaps->map2, cachedFisheye);
+    }
+    catch (const std::exception &e)
+    {
+        // Cache only speeds up next start, calibration works without it
+        cerr << e.what() << endl;
+    }
+    return newMaps;
+}
+
+std::shared_ptr<CameraCalibration::UndistortMaps> CameraCalibration::computeUndistortMaps(
+    const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, bool fisheye, cv::Size imageSize)
+{
+    // Same maps as the ones cv::undistort computes internally on every call
+    auto maps = std::make_shared<UndistortMaps>();
+    if (fisheye)
+        cv::fisheye::initUndistortRectifyMap(cameraMatrix, distCoeffs, cv::Matx33d::eye(), cameraMatrix,
+                                             imageSize, CV_16SC2, maps->map1, maps->map2);
+    else
+        initUndistortRectifyMap(cameraMatrix, distCoeffs, cv::Mat(), cameraMatrix, imageSize, CV_16SC2,
+                                maps->map1, maps->map2);
+    return maps;
+}
+
+void CameraCalibration::getParameters(cv::Mat &cameraMatrix, cv::Mat &distCoeffs, bool &fisheye) const
+{
+    std::lock_guard<std::mutex> lock(mapsMutex);
+    cameraMatrix = this->cameraMatrix.clone();
+    distCoeffs = this->distCoeffs.clone();
+    fisheye = this->fisheye;
+}
+
+void CameraCalibration::setParameters(const cv::Mat &cameraMatrix, const cv::Mat &distCoeffs)
+{
+    vector<std::pair<int, int>> sizes;
+    bool fisheye;
+    {
+        std::lock_guard<std::mutex> lock(mapsMutex);
+        for (const auto &maps : undistortMaps)
+            sizes.push_back(maps.first);
+        fisheye = this->fisheye;
+    }
+
+    std::map<std::pair<int, int>, std::shared_ptr<const UndistortMaps>> newMaps;
+    for (const auto &size : sizes)
+        newMaps[size] = computeUndistortMaps(cameraMatrix, distCoeffs, fisheye, cv::Size(size.first, size.second));
+
+    // Frames being undistorted keep old maps alive until they finish
+    std::lock_guard<std::mutex> lock(mapsMutex);
+    this->cameraMatrix = cameraMatrix.clone();
+    this->distCoeffs = distCoeffs.clone();
+    undistortMaps.swap(newMaps);
+    generation++;
+    // Cache belongs to the calibration file, which no longer describes these parameters
+    calibrationHash = 0;
+}
+
+bool CameraCalibration::distortPoints(const vector<cv::Point2f> &undistorted, vector<cv::Point2f> &distorted,
+                                      uint64_t generation) const
+{
+    cv::Mat cameraMatrix, distCoeffs;
+    bool fisheye;
+    {
+        // Parameters of another generation would put points where they never were
+        std::lock_guard<std::mutex> lock(mapsMutex);
+        if (generation != this->generation)
+            return false;
+        cameraMatrix = this->cameraMatrix.clone();
+        distCoeffs = this->distCoeffs.clone();
+        fisheye = this->fisheye;
+    }
+
+    // Undistorted image is seen through the same camera matrix, without distortion
+    vector<cv::Point3f> rays;
+    rays.reserve(undistorted.size());
+    cv::Mat inverse = cameraMatrix.inv();
+    for (const cv::Point2f &point : undistorted)
+    {
+        double ray[3];
+        for (int row = 0; row < 3; ++row)
+            ray[row] = inverse.at<double>(row, 0) * point.x + inverse.at<double>(row, 1) * point.y +
+                       inverse.at<double>(row, 2);
+        rays.emplace_back(static_cast<float>(ray[0] / ray[2]), static_cast<float>(ray[1] / ray[2]), 1.0f);
+    }
+
+    const cv::Mat zero = cv::Mat::zeros(3, 1, CV_64F);
+    if (fisheye)
+        cv::fisheye::projectPoints(rays, distorted, zero, zero, cameraMatrix, distCoeffs);
+    else
+        projectPoints(rays, zero, zero, cameraMatrix, distCoeffs, distorted);
+    return true;
+}
+
 void CameraCalibration::loadCalibrationFile()
 {
+    std::lock_guard<std::mutex> lock(mapsMutex);
+    undistortMaps.clear();
+    calibrationHash = 0;
+    cacheHasMaps = false;
+
+    // Unreadable file is left to cv::FileStorage, which reports it as before
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(calibrationFileName, error) || error)
+    {
+        cv::FileStorage fs(calibrationFileName, cv::FileStorage::READ);
+        fs["camera_matrix"] >> cameraMatrix;
+        fs["distortion_coefficients"] >> distCoeffs;
+        fs["fisheye_model"] >> fisheye;
+        return;
+    }
+
+    calibrationHash = CalibrationCache::hashFile(calibrationFileName);
+    const std::string cachePath = CalibrationCache::defaultPath(calibrationFileName);
+    try
+    {
+        if (std::filesystem::exists(cachePath))
+        {
+            const CalibrationCache cache(cachePath);
+            if (cache.getSourceHash() == calibrationHash)
+            {
+                cameraMatrix = cache.getCameraMatrix();
+                distCoeffs = cache.getDistCoeffs();
+                fisheye = cache.isFisheye();
+                if (cache.hasMaps())
+                {
+                    const cv::Size size = cache.getMapSize();
+                    undistortMaps[{ size.width, size.height }] = std::make_shared<UndistortMaps>(
+                        UndistortMaps{ cache.getMap1(), cache.getMap2(), cache.getFile() });
+                    cacheHasMaps = true;
+                }
+                return;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        // Broken or old cache is rebuilt from the calibration file
+        cerr << e.what() << endl;
+    }
+
 	cv::FileStorage fs(calibrationFileName, cv::FileStorage::READ);
 	fs["camera_matrix"] >> cameraMatrix;
 	fs["distortion_coefficients"] >> distCoeffs;
+	fs["fisheye_model"] >> fisheye;
+
+    try
+    {
+        CalibrationCache::write(cachePath, calibrationHash, cameraMatrix, distCoeffs, cv::Mat(), cv::Mat(), fisheye);
+    }
+    catch (const std::exception &e)
+    {
+        cerr << e.what() << endl;
+    }
 }
 
 static inline void read(const cv::FileNode& node, Settings& x,
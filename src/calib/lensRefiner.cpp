@@ -0,0 +1,208 @@
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <opencv2/calib3d.hpp>
+
+#include "calib/lensRefiner.hpp"
+
+namespace calibration
+{
+    LensRefiner::LensRefiner(std::shared_ptr<CameraCalibration> calibration, const LensRefinerOptions &options)
+        : calibration(calibration), options(options), framesSinceView(0), viewsSinceRefinement(0), stopping(false)
+    {
+        if (options.markerSize <= 0 || options.viewInterval < 1 || options.minViewChange < 0 || options.maxViews < 2 ||
+            options.refineEvery < 1 || options.minImprovement < 0 || options.minImprovement >= 1)
+            throw std::invalid_argument("Invalid lens refinement options");
+        worker = std::thread(&LensRefiner::work, this);
+    }
+
+    LensRefiner::~LensRefiner()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        worker.join();
+    }
+
+    void LensRefiner::addView(const std::vector<cv::Point3f> &objectPoints,
+                              const std::vector<cv::Point2f> &undistortedPoints, cv::Size imageSize,
+                              uint64_t generation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (framesSinceView++ % options.viewInterval != 0)
+                return;
+        }
+
+        // Views of the same pose only repeat the noise of corners, the fit needs the table seen in other ways
+        std::vector<cv::Point2f> planePoints;
+        for (const cv::Point3f &point : objectPoints)
+            planePoints.emplace_back(point.x, point.y);
+        if (planePoints.size() < 4)
+            return;
+        const cv::Mat homography = cv::findHomography(planePoints, undistortedPoints);
+        if (homography.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!lastHomography.empty() && viewChange(planePoints, lastHomography, homography) < options.minViewChange)
+                return;
+        }
+
+        // Frame undistorted just before a swap is dropped, its points cannot be mapped back any more
+        View view;
+        view.objectPoints = objectPoints;
+        if (!calibration->distortPoints(undistortedPoints, view.imagePoints, generation))
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            views.push_back(std::move(view));
+            if (views.size() > static_cast<size_t>(options.maxViews))
+                views.pop_front();
+            lastHomography = homography;
+            this->imageSize = imageSize;
+            viewsSinceRefinement++;
+        }
+        condition.notify_one();
+    }
+
+    void LensRefiner::work()
+    {
+        for (;;)
+        {
+            std::vector<View> snapshot;
+            cv::Size size;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || viewsSinceRefinement >= options.refineEvery; });
+                if (stopping)
+                    return;
+
+                snapshot.assign(views.begin(), views.end());
+                size = imageSize;
+                viewsSinceRefinement = 0;
+            }
+
+            try
+            {
+                refine(snapshot, size);
+            }
+            catch (const cv::Exception &e)
+            {
+                // Degenerate views, current parameters stay in use
+                std::cerr << "Lens refinement failed: " << e.what() << std::endl;
+            }
+        }
+    }
+
+    bool LensRefiner::refine(const std::vector<View> &views, cv::Size imageSize)
+    {
+        cv::Mat currentCamera, currentDist;
+        bool fisheye;
+        calibration->getParameters(currentCamera, currentDist, fisheye);
+
+        // Every other view is held out, so both parameter sets are judged on views the fit has not seen.
+        // Views are kept in time order, so both halves cover the same period.
+        std::vector<View> heldOut;
+        std::vector<std::vector<cv::Point3f>> objectPoints;
+        std::vector<std::vector<cv::Point2f>> imagePoints;
+        for (size_t i = 0; i < views.size(); ++i)
+        {
+            if (i % 2)
+            {
+                heldOut.push_back(views[i]);
+                continue;
+            }
+            objectPoints.push_back(views[i].objectPoints);
+            imagePoints.push_back(views[i].imagePoints);
+        }
+        if (heldOut.empty())
+            return false;
+
+        // Nearly the same pose in every view, so principal point, aspect ratio and higher-order terms stay fixed
+        cv::Mat cameraMatrix = currentCamera.clone(), distCoeffs = currentDist.clone();
+        std::vector<cv::Mat> rvecs, tvecs;
+        if (fisheye)
+        {
+            cv::fisheye::calibrate(objectPoints, imagePoints, imageSize, cameraMatrix, distCoeffs, rvecs, tvecs,
+                                   cv::fisheye::CALIB_USE_INTRINSIC_GUESS | cv::fisheye::CALIB_FIX_PRINCIPAL_POINT |
+                                   cv::fisheye::CALIB_RECOMPUTE_EXTRINSIC | cv::fisheye::CALIB_FIX_SKEW |
+                                   cv::fisheye::CALIB_FIX_K3 | cv::fisheye::CALIB_FIX_K4);
+        }
+        else
+        {
+            cv::calibrateCamera(objectPoints, imagePoints, imageSize, cameraMatrix, distCoeffs, rvecs, tvecs,
+                                cv::CALIB_USE_INTRINSIC_GUESS | cv::CALIB_FIX_PRINCIPAL_POINT |
+                                cv::CALIB_FIX_ASPECT_RATIO | cv::CALIB_ZERO_TANGENT_DIST | cv::CALIB_FIX_K3 |
+                                cv::CALIB_FIX_K4 | cv::CALIB_FIX_K5 | cv::CALIB_FIX_K6);
+        }
+
+        // Small gains on a few views are noise, swapping parameters for them would only make the lens jitter
+        const double currentError = reprojectionError(heldOut, currentCamera, currentDist, fisheye);
+        const double refinedError = reprojectionError(heldOut, cameraMatrix, distCoeffs, fisheye);
+        if (!(refinedError < currentError * (1.0 - options.minImprovement)))
+            return false;
+
+        calibration->setParameters(cameraMatrix, distCoeffs);
+        std::cout << "Lens parameters refined on " << objectPoints.size() << " views, held-out error "
+                  << currentError << " -> " << refinedError << std::endl;
+
+        if (!options.outputPath.empty())
+        {
+            // Same nodes CameraCalibration reads, so the file can be used as calibConfigPath next time
+            cv::FileStorage fs(options.outputPath, cv::FileStorage::WRITE);
+            fs << "image_width" << imageSize.width;
+            fs << "image_height" << imageSize.height;
+            fs << "camera_matrix" << cameraMatrix;
+            fs << "distortion_coefficients" << distCoeffs;
+            fs << "fisheye_model" << fisheye;
+            fs << "avg_reprojection_error" << refinedError;
+        }
+        return true;
+    }
+
+    double LensRefiner::viewChange(const std::vector<cv::Point2f> &planePoints, const cv::Mat &previous,
+                                   const cv::Mat &next)
+    {
+        std::vector<cv::Point2f> before, after;
+        cv::perspectiveTransform(planePoints, before, previous);
+        cv::perspectiveTransform(planePoints, after, next);
+
+        double sum = 0;
+        for (size_t i = 0; i < planePoints.size(); ++i)
+            sum += cv::norm(after[i] - before[i]);
+        return sum / planePoints.size();
+    }
+
+    // Root mean square error of views with poses fitted to given parameters
+    double LensRefiner::reprojectionError(const std::vector<View> &views, const cv::Mat &cameraMatrix,
+                                          const cv::Mat &distCoeffs, bool fisheye)
+    {
+        double sum = 0;
+        size_t count = 0;
+        for (const View &view : views)
+        {
+            cv::Mat rvec, tvec;
+            std::vector<cv::Point2f> projected;
+            if (fisheye)
+            {
+                std::vector<cv::Point2f> normalized;
+                cv::fisheye::undistortPoints(view.imagePoints, normalized, cameraMatrix, distCoeffs);
+                cv::solvePnP(view.objectPoints, normalized, cv::Mat::eye(3, 3, CV_64F), cv::noArray(), rvec, tvec);
+                cv::fisheye::projectPoints(view.objectPoints, projected, rvec, tvec, cameraMatrix, distCoeffs);
+            }
+            else
+            {
+                cv::solvePnP(view.objectPoints, view.imagePoints, cameraMatrix, distCoeffs, rvec, tvec);
+                cv::projectPoints(view.objectPoints, rvec, tvec, cameraMatrix, distCoeffs, projected);
+            }
+            const double error = cv::norm(view.imagePoints, projected, cv::NORM_L2);
+            sum += error * error;
+            count += view.imagePoints.size();
+        }
+        return count ? std::sqrt(sum / count) : 0.0;
+    }
+} // namespace calibration
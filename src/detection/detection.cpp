@@ -1,54 +1,163 @@
 #include "detection/detection.hpp"
 
-void detection::detectPlayers(bool detectionEnabled, bool debugMode, Mode mode,
-                              PlayersFinder& playersFinder, cv::Mat& frame, cv::Mat& restul)
+// Frames are table images when toTable is empty, regions of camera frames otherwise
+static void detectPlayers(detection::Mode mode, detection::PlayersFinder& playersFinder, const cv::Mat& frame,
+                          const cv::Mat& mask, const cv::Mat& toTable, detection::PlayersDetection& players,
+                          detection::DebugSink* debugSink)
 {
-	const string title = mode == detection::Mode::BLUE_PLAYERS ?
-        "Blue players detection frame" : "Red players detection frame";
+	cv::Mat hsvPlayerFrame = detection::transformToHSV(frame, mode, mask);
+	if (debugSink)
+	{
+		debugSink->debugFrame(mode == detection::Mode::BLUE_PLAYERS ?
+			"Blue players detection frame" : "Red players detection frame", hsvPlayerFrame);
+	}
 
-	if(detectionEnabled)
-    {
-		cv::Mat hsvPlayerFrameBlue = detection::transformToHSV(frame, mode);
-		playersFinder.contoursFiltering(hsvPlayerFrameBlue);
-		playersFinder.detectedPlayersResult(restul, mode);
+	playersFinder.contoursFiltering(hsvPlayerFrame, players, toTable);
+}
 
-		if(debugMode)
-		{
-			cv::imshow(title, hsvPlayerFrameBlue);	
-		}
-		else try { cv::destroyWindow(title); } catch(...) {}
+static void trackBall(detection::FoundBallsState& foundBallsState, double deltaTicks, const cv::Mat& frame,
+                      const cv::Mat& nextFrame, const cv::Mat& mask, const cv::Mat& toTable,
+                      detection::BallDetection& ball, detection::DebugSink* debugSink)
+{
+	if (foundBallsState.getFoundball())
+	{
+		ball.predictedBox = foundBallsState.predict(deltaTicks);
+		ball.predicted = true;
+	}
+
+	cv::Mat rangeRes = detection::transformToHSV(frame, detection::Mode::BALL, mask);
+	cv::Mat rangeRes2 = detection::transformToHSV(nextFrame, detection::Mode::BALL, mask);
+	cv::Mat trackingFrame = detection::tracking(rangeRes, rangeRes2);
+	if (debugSink)
+	{
+		debugSink->debugFrame("Tracking ball frame", trackingFrame);
 	}
-	else try { cv::destroyWindow(title); } catch(...){  }
+
+	foundBallsState.contoursFiltering(trackingFrame, ball, toTable);
+	foundBallsState.measure(ball.boxes);
+	foundBallsState.updateFilter(ball.boxes);
+
+	ball.center = foundBallsState.getCenter();
+	ball.found = foundBallsState.getFoundball();
+	for (int i = 0; i < 6; i++)
+		ball.kalmanState[i] = foundBallsState.kalmanFilter.statePost.at<float>(i);
 }
 
-void detection::trackBall(bool trackingEnabled, bool debugMode,
-                          FoundBallsState& foundBallsState, double deltaTicks,
-                          int& founded, int& counter, cv::Mat& frame, cv::Mat& nextFrame, cv::Mat& restul)
+void detection::detectPlayersOnFrame(Mode mode, PlayersFinder& playersFinder, const cv::Mat& frame,
+                                     PlayersDetection& players, DebugSink* debugSink)
 {
-	const string title = "Tracking ball frame";
+	detectPlayers(mode, playersFinder, frame, getMaskForMode(mode, frame.size()), cv::Mat(), players, debugSink);
+}
 
-	if(trackingEnabled)
-    {
-		if (foundBallsState.getFoundball())
-		{
-			foundBallsState.detectedBalls(restul, deltaTicks);
-		}
+void detection::trackBallOnFrames(FoundBallsState& foundBallsState, double deltaTicks,
+                                  const cv::Mat& frame, const cv::Mat& nextFrame, BallDetection& ball,
+                                  DebugSink* debugSink)
+{
+	trackBall(foundBallsState, deltaTicks, frame, nextFrame, getMaskForMode(Mode::BALL, frame.size()), cv::Mat(),
+	          ball, debugSink);
+}
+
+void detection::detectPlayersInRegion(Mode mode, PlayersFinder& playersFinder, const cv::Mat& frame,
+                                      const CameraRegion& region, PlayersDetection& players, DebugSink* debugSink)
+{
+	detectPlayers(mode, playersFinder, frame(region.roi), region.masks[mode], region.toTable, players, debugSink);
+}
+
+void detection::trackBallInRegion(FoundBallsState& foundBallsState, double deltaTicks,
+                                  const cv::Mat& frame, const cv::Mat& nextFrame, const CameraRegion& region,
+                                  BallDetection& ball, DebugSink* debugSink)
+{
+	trackBall(foundBallsState, deltaTicks, frame(region.roi), nextFrame(region.roi), region.masks[Mode::BALL],
+	          region.toTable, ball, debugSink);
+}
+
+void detection::transformContours(vector<vector<cv::Point> >& contours, const cv::Mat& homography)
+{
+	if (homography.empty())
+		return;
+
+	vector<cv::Point2f> points;
+	for (vector<cv::Point>& contour : contours)
+	{
+		points.assign(contour.begin(), contour.end());
+		cv::perspectiveTransform(points, points, homography);
+		for (size_t i = 0; i < contour.size(); i++)
+			contour[i] = cv::Point(cvRound(points[i].x), cvRound(points[i].y));
+	}
+}
+
+void detection::filterBallCandidates(const vector<vector<cv::Point> >& contours, BallDetection& ball)
+{
+   	for (size_t i = 0; i < contours.size(); i++)
+   	{
+       	cv::Rect bBox;
+       	bBox = cv::boundingRect(contours[i]);
+
+        float ratio = (float) bBox.width / (float) bBox.height;
+   	    if (ratio > 1.0f)
+       	    ratio = 1.0f / ratio;
 
-		cv::Mat rangeRes = detection::transformToHSV(frame, detection::Mode::BALL);
-		cv::Mat rangeRes2 = detection::transformToHSV(nextFrame, detection::Mode::BALL);
-		cv::Mat trackingFrame = detection::tracking(rangeRes, rangeRes2);
-	
-        foundBallsState.contoursFiltering(trackingFrame);
-		foundBallsState.detectedBallsResult(restul);
-		foundBallsState.updateFilter();
-		
-        if(debugMode) cv::imshow(title, trackingFrame);
-		else try { cv::destroyWindow(title); } catch(...){}
-	
-		if (foundBallsState.balls.size()) founded++;
-		counter++;
+        if(ratio > 0.75 && bBox.area() >= 100)
+        {
+            ball.contours.emplace_back(contours[i].begin(), contours[i].end());
+            ball.boxes.push_back(bBox);            
+        }           
 	}
-	else try { cv::destroyWindow(title); } catch(...){}
+}
+
+void detection::collectPlayers(const vector<vector<cv::Point> >& contours, PlayersDetection& players)
+{
+   	for (size_t i = 0; i < contours.size(); i++)
+   	{
+        players.contours.emplace_back(contours[i].begin(), contours[i].end());
+        players.boxes.push_back(cv::boundingRect(contours[i]));
+	}
+}
+
+// Same as cv::drawContours with thickness 1, which accepts only vectors with default allocator
+static void drawContour(cv::Mat& res, const detection::Contour& contour, const cv::Scalar& color)
+{
+	const cv::Point* points = contour.data();
+	const int count = static_cast<int>(contour.size());
+	cv::polylines(res, &points, &count, 1, true, color, 1);
+}
+
+void detection::drawBallDetection(cv::Mat& res, const BallDetection& ball)
+{
+	if (ball.predicted)
+	{
+		cv::Point center(ball.predictedBox.x + ball.predictedBox.width / 2,
+		                 ball.predictedBox.y + ball.predictedBox.height / 2);
+		cv::circle(res, center, 2, CV_RGB(255,0,255), -1);
+		cv::rectangle(res, ball.predictedBox, CV_RGB(255,0,255), 2);
+	}
+
+	for (size_t i = 0; i < ball.boxes.size(); i++)
+   	{
+       	drawContour(res, ball.contours[i], CV_RGB(20,150,20));
+       	cv::rectangle(res, ball.boxes[i], CV_RGB(0,255,0), 2);
+
+		cv::Point c;
+		c.x = ball.boxes[i].x + ball.boxes[i].width / 2;
+       	c.y = ball.boxes[i].y + ball.boxes[i].height / 2;
+       	cv::circle(res, c, 2, CV_RGB(20,150,20), -1);
+   	}
+}
+
+void detection::drawPlayersDetection(cv::Mat& res, const PlayersDetection& players, Mode mode)
+{
+	for (size_t i = 0; i < players.boxes.size(); i++)
+   	{	
+		if(mode == Mode::BLUE_PLAYERS)
+		{
+			drawContour(res, players.contours[i], CV_RGB(100, 100, 255));
+       		cv::rectangle(res, players.boxes[i], CV_RGB(0, 0, 255), 2);
+		}
+		else{
+       		drawContour(res, players.contours[i], CV_RGB(255, 100, 100));
+       		cv::rectangle(res, players.boxes[i], CV_RGB(255, 0, 0), 2);
+		}
+   	}
 }
 
 cv::Mat detection::tracking(cv::Mat image1, cv::Mat image2)
@@ -104,11 +213,16 @@ cv::Mat detection::getMaskForMode(Mode mode, cv::Size size)
 }
 
 cv::Mat detection::transformToHSV(cv::Mat image, Mode mode)
+{
+	return transformToHSV(image, mode, getMaskForMode(mode, cv::Size(image.cols, image.rows)));
+}
+
+cv::Mat detection::transformToHSV(cv::Mat image, Mode mode, const cv::Mat& mask)
 {
 	cv::Mat hsvImage;
 	cv::cvtColor(image, hsvImage, cv::COLOR_BGR2HSV);
 	cv::Mat maskedHSVImage;
-	hsvImage.copyTo(maskedHSVImage, getMaskForMode(mode, cv::Size(hsvImage.cols, hsvImage.rows)));
+	hsvImage.copyTo(maskedHSVImage, mask);
 	cv::Mat lowerHueRange;
 	cv::Mat upperHueRange;
 	cv::inRange(maskedHSVImage, getColorForMode(mode, 0), getColorForMode(mode, 1), lowerHueRange);
@@ -155,25 +269,13 @@ detection::FoundBallsState::FoundBallsState(double ticks, bool foundball, int no
 	detection::FoundBallsState::kalmanFilter = kf;
 }
 
-void detection::FoundBallsState::contoursFiltering(cv::Mat& rangeRes)
+void detection::FoundBallsState::contoursFiltering(cv::Mat& rangeRes, BallDetection& ball, const cv::Mat& toTable)
 {
     cv::findContours(rangeRes, contours, CV_RETR_EXTERNAL,
        	             CV_CHAIN_APPROX_SIMPLE);
-   	for (size_t i = 0; i < contours.size(); i++)
-   	{
-       	cv::Rect bBox;
-       	bBox = cv::boundingRect(contours[i]);
-
-        float ratio = (float) bBox.width / (float) bBox.height;
-   	    if (ratio > 1.0f)
-       	    ratio = 1.0f / ratio;
-
-        if(ratio > 0.75 && bBox.area() >= 100)
-        {
-            balls.push_back(contours[i]);
-            ballsBox.push_back(bBox);            
-        }           
-	}
+	// Size and shape of ball are checked in table space
+	detection::transformContours(contours, toTable);
+	detection::filterBallCandidates(contours, ball);
 }
 
 void detection::FoundBallsState::setCenter(cv::Point x)
@@ -181,7 +283,7 @@ void detection::FoundBallsState::setCenter(cv::Point x)
 	center = x;
 }
 
-void detection::FoundBallsState::detectedBalls(cv::Mat& res, double dT)
+cv::Rect detection::FoundBallsState::predict(double dT)
 {
     kalmanFilter.transitionMatrix.at<float>(2) = dT;
     kalmanFilter.transitionMatrix.at<float>(9) = dT;
@@ -198,29 +300,24 @@ void detection::FoundBallsState::detectedBalls(cv::Mat& res, double dT)
     center.x = state.at<float>(0);
     center.y = state.at<float>(1);
 	setCenter(center);
-    cv::circle(res, center, 2, CV_RGB(255,0,255), -1);
-    cv::rectangle(res, predRect, CV_RGB(255,0,255), 2);
+	return predRect;
 }
 
-void detection::FoundBallsState::detectedBallsResult(cv::Mat& res)
+void detection::FoundBallsState::measure(const std::pmr::vector<cv::Rect>& boxes)
 {
-	for (size_t i = 0; i < balls.size(); i++)
+	for (size_t i = 0; i < boxes.size(); i++)
    	{
-       	cv::drawContours(res, balls, i, CV_RGB(20,150,20), 1);
-       	cv::rectangle(res, ballsBox[i], CV_RGB(0,255,0), 2);
-
 		cv::Point c;
-		c.x = ballsBox[i].x + ballsBox[i].width / 2;
-       	c.y = ballsBox[i].y + ballsBox[i].height / 2;
+		c.x = boxes[i].x + boxes[i].width / 2;
+       	c.y = boxes[i].y + boxes[i].height / 2;
 		setCenter(c);
-       	cv::circle(res, center, 2, CV_RGB(20,150,20), -1);
    	}
 }
 
 
-void detection::FoundBallsState::updateFilter() 
+void detection::FoundBallsState::updateFilter(const std::pmr::vector<cv::Rect>& boxes) 
 {
-    if (balls.size() == 0)
+    if (boxes.size() == 0)
     {
     	setNotFoundCount(getNotFoundCount() + 1);
     	if( getNotFoundCount() >= 10 )
@@ -232,10 +329,10 @@ void detection::FoundBallsState::updateFilter()
     {
     	setNotFoundCount(0);
 
-    	meas.at<float>(0) = ballsBox[0].x + ballsBox[0].width / 2;
-        meas.at<float>(1) = ballsBox[0].y + ballsBox[0].height / 2;
-        meas.at<float>(2) = (float)ballsBox[0].width;
-        meas.at<float>(3) = (float)ballsBox[0].height;
+    	meas.at<float>(0) = boxes[0].x + boxes[0].width / 2;
+        meas.at<float>(1) = boxes[0].y + boxes[0].height / 2;
+        meas.at<float>(2) = (float)boxes[0].width;
+        meas.at<float>(3) = (float)boxes[0].height;
 
         if (!getFoundball())
         {
@@ -262,30 +359,10 @@ void detection::FoundBallsState::updateFilter()
 	}
 }
 
-void detection::PlayersFinder::contoursFiltering(cv::Mat& rangeRes)
+void detection::PlayersFinder::contoursFiltering(cv::Mat& rangeRes, PlayersDetection& result, const cv::Mat& toTable)
 {
     cv::findContours(rangeRes, players, CV_RETR_EXTERNAL,
        	             CV_CHAIN_APPROX_NONE);
-   	for (size_t i = 0; i < players.size(); i++)
-   	{
-       	cv::Rect bBox;
-       	bBox = cv::boundingRect(players[i]);
-        playersBox.push_back(bBox);
-	}
-}
-
-void detection::PlayersFinder::detectedPlayersResult(cv::Mat& res, Mode mode)
-{
-	for (size_t i = 0; i < players.size(); i++)
-   	{	
-		if(mode == Mode::BLUE_PLAYERS)
-		{
-			cv::drawContours(res, players, i, CV_RGB(100, 100, 255), 1);
-       		cv::rectangle(res, playersBox[i], CV_RGB(0, 0, 255), 2);
-		}
-		else{
-       		cv::drawContours(res, players, i, CV_RGB(255, 100, 100), 1);
-       		cv::rectangle(res, playersBox[i], CV_RGB(255, 0, 0), 2);
-		}
-   	}
+	detection::transformContours(players, toTable);
+	detection::collectPlayers(players, result);
 }
@@ -8,7 +8,7 @@ namespace detection
                lastPosition.y > tableSize.y;
     }
 
-    void ScoreCounter::confirmLastEvent() {
+    void ScoreCounter::confirmLastEvent(int frame) {
         switch (lastEvent)
         {
             case LastEventType::EV_OUT:
@@ -20,10 +20,11 @@ namespace detection
             default:
                 return;
         }
+        events.push_back({ lastEvent, lastEventFrame, frame });
         lastEvent = LastEventType::EV_NONE;
     }
 
-    void ScoreCounter::trackBallAndScore(const cv::Point &lastPosition, bool isValid)
+    void ScoreCounter::trackBallAndScore(const cv::Point &lastPosition, bool isValid, int frame)
     {
         if (!clearFlag && isValid) {
             clearFlag = true;
@@ -44,13 +45,14 @@ namespace detection
             {
                 lastEvent = LastEventType::EV_OUT;
             }
+            lastEventFrame = frame;
             notFoundSince = 0;
             clearFlag = false;
         } 
         else if (!isValid) 
         {
             if(++notFoundSince == fps)
-                confirmLastEvent();
+                confirmLastEvent(frame);
         }
     }
 } // namespace detection
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include "detection/table.hpp"
 
 namespace detection
@@ -9,6 +11,23 @@ namespace detection
         return r.dot(r);
     }
 
+    static cv::Point2f toTablePlane(const cv::Mat &homography, const cv::Point2f &point)
+    {
+        double mapped[3];
+        for (int row = 0; row < 3; ++row)
+            mapped[row] = homography.at<double>(row, 0) * point.x + homography.at<double>(row, 1) * point.y +
+                          homography.at<double>(row, 2);
+        return { static_cast<float>(mapped[0] / mapped[2]), static_cast<float>(mapped[1] / mapped[2]) };
+    }
+
+    // Unit vector of the table axis closest to given direction
+    static cv::Point2f alongTableAxis(const cv::Point2f &direction)
+    {
+        if (std::abs(direction.x) >= std::abs(direction.y))
+            return { direction.x < 0 ? -1.0f : 1.0f, 0.0f };
+        return { 0.0f, direction.y < 0 ? -1.0f : 1.0f };
+    }
+
     void Table::updateTableOnFrame(const std::vector<aruco::ArucoMarker> &arucoMarkers) 
     {
         for (const aruco::ArucoMarker &marker : arucoMarkers)
@@ -43,10 +62,45 @@ namespace detection
             corners[markerId] = marker.getCorners()[bestCornerId];
         }
 
-        if (arucoMarkers.size() == 4) {
-            transformationValid = true;
-            transformationMatrix = cv::getPerspectiveTransform(corners.data(), output);
+        std::array<bool, 4> seen = { false, false, false, false };
+        for (const aruco::ArucoMarker &marker : arucoMarkers)
+            seen[marker.getId()] = true;
+        const int seenCount = static_cast<int>(std::count(seen.begin(), seen.end(), true));
+
+        if (seenCount == 4)
+            state = TableState::ACQUIRED;
+        else if (seenCount == 3 && hasTable())
+        {
+            // Seen corners moved from their last position by an affine transform, hidden one moved with them
+            const int hidden = static_cast<int>(std::find(seen.begin(), seen.end(), false) - seen.begin());
+            cv::Point2f from[3], to[3];
+            for (int i = 0, j = 0; i < 4; ++i)
+            {
+                if (i == hidden)
+                    continue;
+                from[j] = lastCorners[i];
+                to[j] = corners[i];
+                ++j;
+            }
+            std::vector<cv::Point2f> predicted;
+            cv::transform(std::vector<cv::Point2f>{ lastCorners[hidden] }, predicted,
+                          cv::getAffineTransform(from, to));
+            corners[hidden] = predicted[0];
+            state = TableState::COMPLETED;
         }
+        else
+        {
+            // Partly updated corners would not match the kept transformation
+            if (hasTable())
+            {
+                corners = lastCorners;
+                state = TableState::HELD;
+            }
+            return;
+        }
+
+        lastCorners = corners;
+        transformationMatrix = cv::getPerspectiveTransform(corners.data(), output);
     }
 
     void Table::drawTableOnFrame(cv::Mat &frame) 
@@ -61,11 +115,94 @@ namespace detection
     {
         cv::Mat result;
 
-        if (transformationValid)
+        if (hasTable())
             cv::warpPerspective(frame, result, transformationMatrix, output_size);
         else
             result = frame;
 
         return result;
     }
+
+    void Table::getTableFromFrame(const cv::Mat &frame, cv::Mat &table)
+    {
+        if (hasTable())
+            cv::warpPerspective(frame, table, transformationMatrix, output_size);
+        else
+            frame.copyTo(table);
+    }
+
+    cv::Rect Table::getBoundingRect() const
+    {
+        if (!hasTable())
+            return cv::Rect();
+
+        return cv::boundingRect(corners);
+    }
+
+    bool Table::updateCameraRegion(cv::Size frameSize, CameraRegion &region) const
+    {
+        if (!hasTable())
+            return false;
+
+        bool moved = region.corners.size() != 4;
+        for (size_t i = 0; i < region.corners.size() && !moved; ++i)
+            moved = euclideanDistance2(region.corners[i], corners[i]) > 1.0;
+        if (!moved)
+            return !region.roi.empty();
+
+        region.corners = corners;
+        region.roi = cv::boundingRect(corners) & cv::Rect(cv::Point(0, 0), frameSize);
+        if (region.roi.empty())
+            return false;
+
+        // Homography of table transform applied to ROI pixels instead of frame pixels
+        const cv::Mat shift = (cv::Mat_<double>(3, 3) << 1, 0, region.roi.x, 0, 1, region.roi.y, 0, 0, 1);
+        region.toTable = transformationMatrix * shift;
+        const cv::Mat toRegion = region.toTable.inv();
+
+        // Pixels outside of the table quad come from outside of the mask and stay zero
+        for (Mode mode : { Mode::BALL, Mode::BLUE_PLAYERS, Mode::RED_PLAYERS })
+            cv::warpPerspective(getMaskForMode(mode, output_size), region.masks[mode], toRegion, region.roi.size(),
+                                cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
+        return true;
+    }
+
+    bool Table::getMarkerCorrespondences(const std::vector<aruco::ArucoMarker> &arucoMarkers, float markerSize,
+                                         std::vector<cv::Point3f> &objectPoints,
+                                         std::vector<cv::Point2f> &imagePoints) const
+    {
+        objectPoints.clear();
+        imagePoints.clear();
+        if (state != TableState::ACQUIRED || arucoMarkers.size() != 4)
+            return false;
+
+        for (const aruco::ArucoMarker &marker : arucoMarkers)
+        {
+            const int id = marker.getId();
+            const std::array<cv::Point2f, 4> &markerCorners = marker.getCorners();
+
+            // Marker corner updateTableOnFrame chose as table corner, it lies at the table corner on the plane
+            const int first = static_cast<int>(std::min_element(markerCorners.begin(), markerCorners.end(),
+                [this, id](const cv::Point2f &a, const cv::Point2f &b) {
+                    return euclideanDistance2(a, corners[id]) < euclideanDistance2(b, corners[id]);
+                }) - markerCorners.begin());
+
+            // Remaining corners follow in the marker's own order, their edges run along the table axes
+            // the table transform maps them to
+            const cv::Point2f origin = toTablePlane(transformationMatrix, markerCorners[first]);
+            const cv::Point2f alongFirst = markerSize * alongTableAxis(
+                toTablePlane(transformationMatrix, markerCorners[(first + 1) % 4]) - origin);
+            const cv::Point2f alongLast = markerSize * alongTableAxis(
+                toTablePlane(transformationMatrix, markerCorners[(first + 3) % 4]) - origin);
+            const cv::Point2f plane[4] = { output[id], output[id] + alongFirst,
+                                           output[id] + alongFirst + alongLast, output[id] + alongLast };
+
+            for (int i = 0; i < 4; ++i)
+            {
+                objectPoints.emplace_back(plane[i].x, plane[i].y, 0.0f);
+                imagePoints.push_back(markerCorners[(first + i) % 4]);
+            }
+        }
+        return true;
+    }
 } // namespace detection
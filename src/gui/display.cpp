@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "gui/display.hpp"
+
+namespace gui
+{
+    Display::Display(Controls &controls, double rate, cv::Size tableSize)
+        : controls(controls),
+          period(static_cast<long long>(1000.0 / std::max(rate, 1.0))),
+          tableSize(tableSize),
+          mailboxFull(false),
+          background(tableSize.height + 90, tableSize.width + 10, CV_8UC3, cv::Scalar::all(0)),
+          tableArea(5, 45, tableSize.width, tableSize.height),
+          scoreBand(0, 0, tableSize.width + 10, 45),
+          statisticsBand(0, tableSize.height + 45, tableSize.width + 10, 45)
+    {
+        printKeyDoc(background, 300, tableSize.height + 65);
+        valuesX = printStatisticsLabels(background, 10, tableSize.height + 65);
+        canvas = background.clone();
+    }
+
+    void Display::post(DisplayFrame frame)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mailbox = std::move(frame);
+        mailboxFull = true;
+    }
+
+    void Display::run()
+    {
+        while (!controls.quit)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + period;
+
+            DisplayFrame frame;
+            bool fresh = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (mailboxFull)
+                {
+                    frame = std::move(mailbox);
+                    mailboxFull = false;
+                    fresh = true;
+                }
+            }
+            if (fresh)
+                render(frame);
+
+            // Waiting for keys also runs the window event loop, so it fills the rest of the period
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            handlePressedKeys(cv::waitKey(std::max(1, static_cast<int>(remaining.count()))), controls);
+        }
+    }
+
+    void Display::showWindow(const std::string &title, const cv::Mat &image, std::vector<std::string> &shown)
+    {
+        cv::imshow(title, image);
+        shown.push_back(title);
+    }
+
+    void Display::render(const DisplayFrame &frame)
+    {
+        std::vector<std::string> shown;
+        if (!frame.original.empty())
+            showWindow("Original frame", frame.original, shown);
+        for (const auto &debugFrame : frame.debugFrames)
+            showWindow(debugFrame.first, debugFrame.second, shown);
+
+        if (!frame.table.empty())
+        {
+            background(scoreBand).copyTo(canvas(scoreBand));
+            background(statisticsBand).copyTo(canvas(statisticsBand));
+
+            // Table is shown upside down, flipping in place keeps detections in table coordinates
+            cv::Mat tableView = canvas(tableArea);
+            if (frame.table.size() == tableView.size())
+            {
+                frame.table.copyTo(tableView);
+                drawDetections(tableView, frame.detections);
+            }
+            else
+            {
+                // Table not found yet, whole frame is shown scaled without detections
+                cv::resize(frame.table, tableView, tableView.size());
+            }
+            cv::flip(tableView, tableView, 0);
+
+            printScoreBoard(frame.scoreLeft, frame.scoreRight, frame.scoreOuts, canvas,
+                            (int)(5.0 / 12 * tableSize.width), 30);
+            showCenterPosition(canvas, frame.ballCenter, valuesX, tableSize.height + 65);
+            showStatistics(canvas, frame.foundCount, frame.processedCount, valuesX, tableSize.height + 80);
+            showAllocations(canvas, frame.frameAllocations, 10, 30);
+            showWindow("Foosball", canvas, shown);
+        }
+
+        // Windows are closed once, when their views get switched off
+        for (const std::string &title : openWindows)
+            if (std::find(shown.begin(), shown.end(), title) == shown.end())
+            {
+                try { cv::destroyWindow(title); } catch (...) {}
+            }
+        openWindows = std::move(shown);
+    }
+} // namespace gui
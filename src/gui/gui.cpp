@@ -1,69 +1,58 @@
 #include "gui/gui.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
 #include <string>
-#include <sstream>
 using namespace std;
 
-void gui::showOriginalFrame(bool originalEnabled, cv::Mat& frame)
+void gui::DebugFrameCollector::debugFrame(const string& title, const cv::Mat& frame)
 {
-	const string title = "Original frame";
-	if(originalEnabled)
-	{
-		cv::imshow(title, frame);
-	}
-	else
-	{
-		try{
-			cv::destroyWindow(title);
-		}catch(...){}
-	}
+	frames.emplace_back(title, frame.clone());
 }
 
-void gui::handlePressedKeys(int key, bool& originalEnabled, bool& trackingEnabled, bool& blueDetectionEnabled, bool& redDetectionEnabled, bool& pause, bool& debugMode)
+void gui::drawDetections(cv::Mat& frame, const detection::FrameDetections& detections)
+{
+	detection::drawBallDetection(frame, detections.ball);
+	detection::drawPlayersDetection(frame, detections.redPlayers, detection::Mode::RED_PLAYERS);
+	detection::drawPlayersDetection(frame, detections.bluePlayers, detection::Mode::BLUE_PLAYERS);
+}
+
+void gui::handlePressedKeys(int key, Controls& controls)
 {
 	switch(key){
 		case 27: //'esc' key has been pressed, exit program.
-			exit(EXIT_SUCCESS);
+			controls.quit = true;
+			break;
 		case 'o': //'t' has been pressed. this will toggle tracking
-			originalEnabled = !originalEnabled;
-			if(originalEnabled == false) cout<<"Origin frame disabled."<<endl;
+			controls.originalEnabled = !controls.originalEnabled;
+			if(controls.originalEnabled == false) cout<<"Origin frame disabled."<<endl;
 			else cout<<"Origin frame enabled."<<endl;
 			break;
 		case 't': //'t' has been pressed. this will toggle tracking
-			trackingEnabled = !trackingEnabled;
-			if(trackingEnabled == false) cout<<"Tracking ball disabled."<<endl;
+			controls.trackingEnabled = !controls.trackingEnabled;
+			if(controls.trackingEnabled == false) cout<<"Tracking ball disabled."<<endl;
 			else cout<<"Tracking ball enabled."<<endl;
 			break;
 		case 'b': //'b' has been pressed. this will toggle blue players detection
-			blueDetectionEnabled = !blueDetectionEnabled;
-			if(blueDetectionEnabled == false) cout<<"Blue players detection disabled."<<endl;
+			controls.blueDetectionEnabled = !controls.blueDetectionEnabled;
+			if(controls.blueDetectionEnabled == false) cout<<"Blue players detection disabled."<<endl;
 			else cout<<"Blue players detection enabled."<<endl;
 			break;
 		case 'r': //'r' has been pressed. this will toggle red players detection
-			redDetectionEnabled = !redDetectionEnabled;
-			if(redDetectionEnabled == false) cout<<"Red players detection disabled."<<endl;
+			controls.redDetectionEnabled = !controls.redDetectionEnabled;
+			if(controls.redDetectionEnabled == false) cout<<"Red players detection disabled."<<endl;
 			else cout<<"Red players detection enabled."<<endl;
 			break;
 		case 'd': //'d' has been pressed. this will debug mode
-			debugMode = !debugMode;
-			if(debugMode == false) cout<<"Debug mode disabled."<<endl;
+			controls.debugMode = !controls.debugMode;
+			if(controls.debugMode == false) cout<<"Debug mode disabled."<<endl;
 			else cout<<"Debug mode enabled."<<endl;
 			break;
-		case 'p': //'p' has been pressed. this will pause/resume the code.
-			pause = !pause;
-			if(pause == true){ 
-				cout<<"Code paused, press 'p' again to resume"<<endl;
-				while (pause == true){
-					//stay in this loop until 
-					switch (cv::waitKey()){
-						//a switch statement inside a switch statement? Mind blown.
-						case 'p': 
-						//change pause back to false
-						pause = false;
-						cout<<"Code resumed."<<endl;
-						break;
-					}
-				}
-			}
+		case 'p': //'p' has been pressed. this will pause/resume processing, display keeps handling keys
+			controls.paused = !controls.paused;
+			if(controls.paused == true) cout<<"Code paused, press 'p' again to resume"<<endl;
+			else cout<<"Code resumed."<<endl;
+			break;
 		}
 }
 
@@ -95,30 +84,48 @@ void gui::printKeyDoc(cv::Mat& frame, int x, int y)
 	0.5, cv::Scalar(255, 255, 255), 1, CV_AA);
 }
 
-void gui::printScoreBoard(detection::ScoreCounter& scoreCounter, cv::Mat &res, int x, int y)
+void gui::printScoreBoard(int scoreLeft, int scoreRight, int scoreOuts, cv::Mat &res, int x, int y)
 {
-    stringstream ss;
-    ss << scoreCounter.getScoreLeft() << " - "
-       << scoreCounter.getScoreRight() << " (outs: " << scoreCounter.getScoreOuts() << ')';
-    cv::putText(res, ss.str(), cv::Point(x, y), cv::FONT_HERSHEY_DUPLEX,
+    char text[64];
+    snprintf(text, sizeof(text), "%d - %d (outs: %d)", scoreLeft, scoreRight, scoreOuts);
+    cv::putText(res, text, cv::Point(x, y), cv::FONT_HERSHEY_DUPLEX,
         1, cv::Scalar(255, 255, 255), 2, CV_AA);
 }
 
+int gui::printStatisticsLabels(cv::Mat& res, int x, int y)
+{
+	const string centerLabel = "Ball position: ";
+	const string accuracyLabel = "Ball tracking accuracy: ";
+	cv::putText(res, centerLabel, cv::Point(x,y), cv::FONT_HERSHEY_DUPLEX, 0.5,
+				cv::Scalar(255,255,255), 1, CV_AA);
+	cv::putText(res, accuracyLabel, cv::Point(x,y+15), cv::FONT_HERSHEY_DUPLEX, 0.5,
+				cv::Scalar(255,255,255), 1, CV_AA);
+
+	int baseLine = 0;
+	return x + max(cv::getTextSize(centerLabel, cv::FONT_HERSHEY_DUPLEX, 0.5, 1, &baseLine).width,
+	               cv::getTextSize(accuracyLabel, cv::FONT_HERSHEY_DUPLEX, 0.5, 1, &baseLine).width);
+}
+
 void gui::showCenterPosition(cv::Mat& res, cv::Point center, int x, int y)
 {
-	string xOfCenter = to_string(center.x);
-	string yOfCenter = to_string(center.y);
-	string tmp = "Ball position: (" + xOfCenter + ", " + yOfCenter + ')';
-	cv::putText(res, tmp, cv::Point(x,y), cv::FONT_HERSHEY_DUPLEX, 0.5, 
+	char text[32];
+	snprintf(text, sizeof(text), "(%d, %d)", center.x, center.y);
+	cv::putText(res, text, cv::Point(x,y), cv::FONT_HERSHEY_DUPLEX, 0.5, 
 				cv::Scalar(255,255,255), 1, CV_AA);
 }
 
 void gui::showStatistics(cv::Mat& res, int founded, int all, int x, int y)
 {
-	int tmp = founded*1.0/(all*1.0)*100;
-	string t = to_string(tmp);
-	string result = "Ball tracking accuracy: " + t + '%';
-	        
-    cv::putText(res, result, cv::Point(x,y), cv::FONT_HERSHEY_DUPLEX, 0.5,
+	char text[16];
+	snprintf(text, sizeof(text), "%d%%", all > 0 ? founded * 100 / all : 0);
+    cv::putText(res, text, cv::Point(x,y), cv::FONT_HERSHEY_DUPLEX, 0.5,
+				 cv::Scalar(255,255,255), 1, CV_AA);
+}
+
+void gui::showAllocations(cv::Mat& res, long long allocations, int x, int y)
+{
+	char text[48];
+	snprintf(text, sizeof(text), "Frame allocations: %lld", allocations);
+    cv::putText(res, text, cv::Point(x,y), cv::FONT_HERSHEY_DUPLEX, 0.5,
 				 cv::Scalar(255,255,255), 1, CV_AA);
 }
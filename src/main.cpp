@@ -1,7 +1,9 @@
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 #include <opencv2/aruco.hpp>
@@ -14,7 +16,20 @@
 #include "detection/detection.hpp"
 #include "detection/score.hpp"
 #include "detection/table.hpp"
+#include "gui/display.hpp"
 #include "gui/gui.hpp"
+#include "pipeline/analysis.hpp"
+#include "pipeline/batch.hpp"
+#include "pipeline/jobQueue.hpp"
+#include "pipeline/scheduler.hpp"
+#include "pipeline/session.hpp"
+#include "pipeline/shard.hpp"
+#include "util/framePool.hpp"
+#include "util/threadPool.hpp"
+#include "video/activity.hpp"
+#include "video/frameSource.hpp"
+#include "video/keyframeIndex.hpp"
+#include "video/sampler.hpp"
 
 using namespace std;
 
@@ -37,99 +52,300 @@ nlohmann::json readConfiguration(const string &filename)
     return config;
 }
 
-int main()
+// Scans video once and writes keyframe index next to it (or to given path)
+int buildKeyframeIndex(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "Usage: " << argv[0] << " index <video path> [index path]\n";
+        return EXIT_FAILURE;
+    }
+
+    const string videoPath = argv[2];
+    const string indexPath = argc > 3 ? argv[3] : video::KeyframeIndex::defaultPath(videoPath);
+    video::KeyframeIndex::build(videoPath, indexPath);
+
+    video::KeyframeIndex index(indexPath);
+    cout << "Written " << index.size() << (index.isExact() ? " keyframes" : " seek points")
+         << " of " << index.getFrameCount() << " frames to " << indexPath << '\n';
+    return EXIT_SUCCESS;
+}
+
+video::FrameSampler createSampler(const nlohmann::json &config)
+{
+    return video::FrameSampler(
+        video::parseSamplingPolicy(config.value("videoSamplingPolicy", "fixed")),
+        config.at("videoSkipFramesStep").get<int>(),
+        config.value("videoSamplingMinSkip", 0),
+        config.value("videoSamplingMaxSkip", 30),
+        config.value("videoSamplingTargetDisplacement", 15.0));
+}
+
+// Headless analysis of the whole video split into chunks processed in parallel
+int runAnalysis(int argc, char *argv[])
 {
-    bool originalEnabled { false },
-        trackingEnabled { true },
-        blueDetectionEnabled { false },
-        redDetectionEnabled{ false },
-        debugMode{ false },
-        pause{ false };
-    
-    // Parse JSON configuration
     nlohmann::json config = readConfiguration("configuration.json");
+    const string videoPath = argc > 2 ? argv[2] : config["videoPath"].get<string>();
+    const string resultPath = argc > 3 ? argv[3] : videoPath + ".json";
+
+    const pipeline::Assets assets = pipeline::loadAssets(config);
+    const pipeline::AnalysisOptions options = { createSampler(config),
+                                                config.value("analysisOverlapSeconds", 2.0) };
+
+    // Chunks are the unit of parallelism, so OpenCV should not spawn its own threads inside them
+    cv::setNumThreads(1);
+    util::ThreadPool pool(config.value("analysisThreads", 0));
+    int chunks = config.value("analysisChunks", 0);
+    if (chunks <= 0)
+        chunks = 2 * static_cast<int>(pool.size());
 
-    // Initialize aruco markers detector
-    vector<aruco::ArucoMarker> found, rejected; 
-    auto aruco_dict = aruco::createDictionary(config["arucoDictionaryPath"].get<string>(), 5);
-    auto detector = aruco::loadParametersFromFile(config["arucoDetectorConfigPath"].get<string>());
-	
-    // Initialize camera calibration module
-    // Run calibration if calibration file path was not provided
-    calibration::CameraCalibration cameraCalibration(config["calibInitConfigPath"].get<string>(),
-                                                     config["calibConfigPath"].get<string>());
-    if (config["calibConfigPath"].get<string>().empty())
+    const double start = static_cast<double>(cv::getTickCount());
+    const pipeline::Result result = pipeline::analyzeVideo(videoPath, assets, options, pool, chunks);
+    pipeline::writeResult(resultPath, result);
+
+    cout << "Analyzed " << videoPath << " in " << (cv::getTickCount() - start) / cv::getTickFrequency()
+         << " s using " << pool.size() << " threads, result written to " << resultPath << '\n';
+    return EXIT_SUCCESS;
+}
+
+// Analyzes many videos with one set of assets, writing a result file per video
+int runBatch(int argc, char *argv[])
+{
+    if (argc < 3)
     {
-        cameraCalibration.init();
+        cout << "Usage: " << argv[0] << " batch <video, directory or pattern>...\n";
+        return EXIT_FAILURE;
     }
 
-    // Initialize game table object with fixed size along with score counter
-    detection::Table gameTable(config["gameTableWidth"].get<int>(), config["gameTableHeight"].get<int>());
-    detection::ScoreCounter scoreCounter(gameTable.getSize(), 24);
+    nlohmann::json config = readConfiguration("configuration.json");
+    const vector<string> videoPaths = pipeline::expandVideoPaths(vector<string>(argv + 2, argv + argc));
+
+    const pipeline::Assets assets = pipeline::loadAssets(config);
+    const pipeline::AnalysisOptions analysisOptions = { createSampler(config),
+                                                        config.value("analysisOverlapSeconds", 2.0) };
+    const pipeline::BatchOptions batchOptions = {
+        config.value("batchOutputDirectory", "results"),
+        static_cast<size_t>(config.value("batchMemoryBudgetMB", 2048)) << 20
+    };
 
-    int counter = 0, founded = 0; 
-    detection::FoundBallsState foundBallsState(0.0, false, 0);
-    detection::PlayersFinder redPlayersFinder, bluePlayersFinder;
+    // Videos are the unit of parallelism, so OpenCV should not spawn its own threads inside them
+    cv::setNumThreads(1);
+    util::ThreadPool pool(config.value("analysisThreads", 0));
+
+    const double start = static_cast<double>(cv::getTickCount());
+    const pipeline::BatchSummary summary =
+        pipeline::analyzeBatch(videoPaths, assets, analysisOptions, batchOptions, pool);
+
+    cout << "Analyzed " << summary.analyzed << " videos (" << summary.skipped << " skipped, "
+         << summary.failed << " failed) in " << (cv::getTickCount() - start) / cv::getTickFrequency()
+         << " s using " << pool.size() << " threads\n";
+    return summary.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Job directory shared by shard workers, with heartbeat timeout from configuration
+pipeline::JobQueue openJobQueue(const nlohmann::json &config, const string &directory)
+{
+    const double timeoutSeconds = config.value("shardTimeoutSeconds", 60.0);
+    return pipeline::JobQueue(directory, pipeline::JobQueue::defaultWorkerId(),
+                              chrono::milliseconds(static_cast<long long>(timeoutSeconds * 1000)));
+}
+
+// Sharded analysis: enqueue videos, run workers on any number of machines, merge their results
+int runShard(int argc, char *argv[])
+{
+    const string command = argv[1];
+    if (argc < 3 || (command == "enqueue" && argc < 4))
+    {
+        cout << "Usage: " << argv[0] << " enqueue <job directory> <video, directory or pattern>...\n"
+             << "       " << argv[0] << " shard <job directory>\n"
+             << "       " << argv[0] << " merge <job directory> [output directory]\n";
+        return EXIT_FAILURE;
+    }
+
+    nlohmann::json config = readConfiguration("configuration.json");
+    pipeline::JobQueue queue = openJobQueue(config, argv[2]);
+
+    if (command == "enqueue")
+    {
+        const vector<string> videoPaths = pipeline::expandVideoPaths(vector<string>(argv + 3, argv + argc));
+        const int added = pipeline::enqueueVideos(queue, videoPaths, config.value("shardChunks", 1));
+        cout << "Enqueued " << added << " jobs of " << videoPaths.size() << " videos\n";
+    }
+    else if (command == "shard")
+    {
+        const pipeline::Assets assets = pipeline::loadAssets(config);
+        const pipeline::AnalysisOptions options = { createSampler(config),
+                                                    config.value("analysisOverlapSeconds", 2.0) };
+
+        cv::setNumThreads(1);
+        const double heartbeatSeconds = config.value("shardHeartbeatSeconds", 10.0);
+        pipeline::runShardWorker(queue, assets, options, config.value("analysisThreads", 0),
+                                 chrono::milliseconds(static_cast<long long>(heartbeatSeconds * 1000)));
+    }
+    else
+    {
+        const string outputDirectory = argc > 3 ? argv[3] : config.value("batchOutputDirectory", "results");
+        cout << "Merged results of " << pipeline::mergeShardResults(queue, outputDirectory) << " videos into "
+             << outputDirectory << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+// Follows several tables at once, each video stream gets its own session
+int runTables(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "Usage: " << argv[0] << " tables <video or stream>...\n";
+        return EXIT_FAILURE;
+    }
+
+    nlohmann::json config = readConfiguration("configuration.json");
+    const pipeline::Assets assets = pipeline::loadAssets(config);
+    const pipeline::AnalysisOptions options = { createSampler(config),
+                                                config.value("analysisOverlapSeconds", 2.0) };
+    const pipeline::BatchOptions batchOptions = { config.value("batchOutputDirectory", "results"), 0 };
+
+    cv::setNumThreads(1);
+    util::ThreadPool pool(config.value("analysisThreads", 0));
+    pipeline::Scheduler scheduler(assets, options, pool);
+    for (int i = 2; i < argc; i++)
+        scheduler.addStream(argv[i]);
+
+    filesystem::create_directories(batchOptions.outputDirectory);
+    for (const pipeline::Result &result : scheduler.run())
+    {
+        const string resultPath = pipeline::batchResultPath(result.video, batchOptions);
+        pipeline::writeResult(resultPath, result);
+        cout << "Finished " << result.video << ", result written to " << resultPath << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && string(argv[1]) == "index")
+        return buildKeyframeIndex(argc, argv);
+    if (argc > 1 && string(argv[1]) == "analyze")
+        return runAnalysis(argc, argv);
+    if (argc > 1 && string(argv[1]) == "batch")
+        return runBatch(argc, argv);
+    if (argc > 1 && string(argv[1]) == "tables")
+        return runTables(argc, argv);
+    if (argc > 1 && (string(argv[1]) == "enqueue" || string(argv[1]) == "shard" || string(argv[1]) == "merge"))
+        return runShard(argc, argv);
+
+    // Parse JSON configuration
+    nlohmann::json config = readConfiguration("configuration.json");
+
+    // Aruco dictionary, detector parameters and camera calibration,
+    // calibration is run if calibration file path was not provided
+    const pipeline::Assets assets = pipeline::loadAssets(config);
+
+    // Choose how many frames are skipped after each processed one
+    video::FrameSampler sampler = createSampler(config);
 
     // Initialize video capture object with video file and start processing
-    cv::Mat frame, flippedFrame, nextFrame;
-    cv::VideoCapture capture(config["videoPath"].get<string>());
+    const string videoPath = config["videoPath"].get<string>();
+    video::FrameSource capture(videoPath);
 
-    while(capture.read(frame))
+    // Keyframe index lets the stream resume in the middle of file without decoding everything before
+    const string indexPath = video::KeyframeIndex::defaultPath(videoPath);
+    if (filesystem::exists(indexPath))
     {
-        gui::showOriginalFrame(originalEnabled, frame);
-
-        for (int i=0; i<config["videoSkipFramesStep"].get<int>(); ++i) capture >> frame;
-
-	capture.read(nextFrame);
-        
-        const double precTick = foundBallsState.getTicks();
-        foundBallsState.setTicks(static_cast<double>(cv::getTickCount()));
-        const double deltaTicks = (foundBallsState.getTicks() - precTick) / cv::getTickFrequency();
-		
-        // Remove distortion from capture frame
-        frame = cameraCalibration.getUndistortedImage(frame);
-        nextFrame = cameraCalibration.getUndistortedImage(nextFrame);
-
-        // Detect aruco markers on captured frame and find table bounding box
-        aruco::detectArucoOnFrame(frame, aruco_dict, found, rejected, detector);
-        gameTable.updateTableOnFrame(found);
-        frame = gameTable.getTableFromFrame(frame);
-		
-	aruco::detectArucoOnFrame(nextFrame, aruco_dict, found, rejected, detector);
-        gameTable.updateTableOnFrame(found);
-        nextFrame = gameTable.getTableFromFrame(nextFrame);
-
-	cv::Mat restul;
-	frame.copyTo(restul);
-
-	// Ball detection
-	detection::trackBall(trackingEnabled, debugMode, foundBallsState, deltaTicks, founded, counter, frame, nextFrame, restul);
-		
-	// Players detection		
-	detection::detectPlayers(redDetectionEnabled, debugMode, detection::Mode::RED_PLAYERS, redPlayersFinder, frame, restul);
-	detection::detectPlayers(blueDetectionEnabled, debugMode, detection::Mode::BLUE_PLAYERS, bluePlayersFinder, frame, restul);
-        
-	cv::flip(restul, flippedFrame, 0);
-
-	// Calculate and show ball position and score
-        scoreCounter.trackBallAndScore(foundBallsState.getCenter(), foundBallsState.getFoundball()); 
-        
-        // Display GUI elements and score board
-        cv::copyMakeBorder(flippedFrame, flippedFrame, 45, 45, 5, 5, cv::BORDER_CONSTANT);
-        gui::printScoreBoard(scoreCounter, flippedFrame, (int)(5.0 / 12 * config["gameTableWidth"].get<int>()), 30);
-        gui::showCenterPosition(flippedFrame, foundBallsState.getCenter(), 10, config["gameTableHeight"].get<int>() + 65);
-        gui::showStatistics(flippedFrame, founded, counter, 10, config["gameTableHeight"].get<int>() + 80);
-	gui::printKeyDoc(flippedFrame, 300, config["gameTableHeight"].get<int>() + 65);
-	cv::imshow("Foosball", flippedFrame);
-		
-	redPlayersFinder.clearVectors();
-	bluePlayersFinder.clearVectors();
-        foundBallsState.clearVectors();
-
-	gui::handlePressedKeys(cv::waitKey(10), originalEnabled, trackingEnabled,
-			       blueDetectionEnabled, redDetectionEnabled, pause, debugMode);
+        auto index = make_shared<const video::KeyframeIndex>(indexPath);
+        if (index->matches(videoPath))
+            capture.useIndex(index);
     }
-	
+    if (const int startFrame = config.value("videoStartFrame", 0); startFrame > 0)
+        capture.seek(startFrame);
+
+    // Frames of input and table size are recycled instead of being allocated for every frame,
+    // everything holding pooled frames (session, display) is declared after the pool
+    util::FramePool framePool(capture.getFrameSize(), assets.tableSize,
+                              config.value("framePoolBuffers", 4), config.value("framePoolHugePages", false));
+
+    // Game table, ball tracker, players finders and score counter of the table
+    pipeline::Session session(assets);
+    pipeline::SessionOptions &sessionOptions = session.getOptions();
+    session.useFramePool(&framePool);
+    // Only this session watches the calibrated camera, batch analysis may mix recordings of many
+    sessionOptions.lensRefinementEnabled = true;
+
+    // Display runs on this thread at its own rate, switches set by keys are shared with processing
+    gui::Controls controls;
+    gui::Display display(controls, config.value("displayRate", 30.0), assets.tableSize);
+
+    // Fast-forward idle parts of recording, or skip them if they were found in previous run
+    const string segmentsPath = config.value("activitySegmentsPath", "");
+    video::ActivityMonitor activityMonitor(
+        static_cast<int>(config.value("activityIdleSeconds", 0.0) * capture.getFps()),
+        config.value("activityFastForwardStep", 60),
+        config.value("activityThreshold", 0.02));
+    if (!segmentsPath.empty())
+        activityMonitor.useKnownSegments(video::readSegments(segmentsPath, videoPath));
+
+    thread processing([&]() {
+        cv::Mat frame, nextFrame;
+        util::leaseBuffer(frame, &framePool);
+        util::leaseBuffer(nextFrame, &framePool);
+        long long allocations = framePool.getAllocations();
+        while(!controls.quit && activityMonitor.skipIdle(capture) && capture.read(frame))
+        {
+            while (controls.paused && !controls.quit)
+                this_thread::sleep_for(chrono::milliseconds(10));
+
+            const int framePosition = capture.getPosition() - 1;
+
+            // Table bounding box comes from undistorted frame, so keep some margin around it
+            cv::Rect activityRegion = session.getTable().getBoundingRect();
+            activityRegion -= cv::Point(activityRegion.width / 10, activityRegion.height / 10);
+            activityRegion += cv::Size(activityRegion.width / 5, activityRegion.height / 5);
+            const detection::FoundBallsState &foundBallsState = session.getBallsState();
+            const bool idle = activityMonitor.update(frame, activityRegion, framePosition,
+                                                     foundBallsState.getFoundball());
+
+            capture.read(nextFrame);
+
+            // Undistort, find table, track ball and players and count score
+            sessionOptions.trackingEnabled = controls.trackingEnabled;
+            sessionOptions.redDetectionEnabled = controls.redDetectionEnabled;
+            sessionOptions.blueDetectionEnabled = controls.blueDetectionEnabled;
+            gui::DebugFrameCollector debugFrames;
+            const detection::FrameDetections &detections = session.process(
+                frame, nextFrame, framePosition, capture.getFps(), controls.debugMode ? &debugFrames : nullptr);
+
+            // Snapshot for display, frames produced by session are new every time and need no copy
+            gui::DisplayFrame displayFrame;
+            if (controls.originalEnabled)
+                displayFrame.original = frame.clone();
+            displayFrame.table = session.getTableFrame();
+            displayFrame.detections = detections;
+            displayFrame.debugFrames = move(debugFrames.frames);
+            displayFrame.scoreLeft = session.getScoreCounter().getScoreLeft();
+            displayFrame.scoreRight = session.getScoreCounter().getScoreRight();
+            displayFrame.scoreOuts = session.getScoreCounter().getScoreOuts();
+            displayFrame.ballCenter = foundBallsState.getCenter();
+            displayFrame.foundCount = session.getFoundCount();
+            displayFrame.processedCount = session.getProcessedCount();
+            displayFrame.frameAllocations = framePool.getAllocations() - allocations;
+            allocations = framePool.getAllocations();
+            display.post(move(displayFrame));
+
+            // Skipped frames are only grabbed, they are never decoded to BGR
+            capture.skip(sampler.framesToSkip(foundBallsState, capture.getFps()));
+
+            if (idle && !activityMonitor.fastForward(capture, activityRegion))
+                break;
+        }
+
+        // Written once for a fully processed recording, a partial file would hide the unprocessed rest next run
+        if (!segmentsPath.empty() && activityMonitor.isDetecting() && !controls.quit)
+            video::writeSegments(segmentsPath, videoPath, activityMonitor.finish(capture.getPosition()));
+        controls.quit = true;
+    });
+
+    display.run();
+    processing.join();
     return 0;
 }
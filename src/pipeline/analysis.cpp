@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+
+#include "pipeline/analysis.hpp"
+#include "pipeline/session.hpp"
+#include "video/frameSource.hpp"
+
+namespace pipeline
+{
+    std::shared_ptr<const video::KeyframeIndex> loadOrBuildIndex(const std::string &videoPath)
+    {
+        std::string indexPath = video::KeyframeIndex::defaultPath(videoPath);
+        if (std::filesystem::exists(indexPath))
+        {
+            auto index = std::make_shared<const video::KeyframeIndex>(indexPath);
+            if (index->matches(videoPath))
+                return index;
+        }
+
+        // Directory with recordings may be read-only, keep the index in temporary directory then
+        try
+        {
+            video::KeyframeIndex::build(videoPath, indexPath);
+        }
+        catch (const std::filesystem::filesystem_error &)
+        {
+            indexPath = (std::filesystem::temp_directory_path() /
+                         std::filesystem::path(indexPath).filename()).string();
+            video::KeyframeIndex::build(videoPath, indexPath);
+        }
+        return std::make_shared<const video::KeyframeIndex>(indexPath);
+    }
+
+    Result analyzeRange(const std::string &videoPath, std::shared_ptr<const video::KeyframeIndex> index,
+                        video::Segment range, const Assets &assets, const AnalysisOptions &options)
+    {
+        video::FrameSource source(videoPath);
+        if (!source.isOpened())
+            throw std::runtime_error("Cannot open video file " + videoPath);
+        source.useIndex(index);
+
+        const int overlap = static_cast<int>(options.overlapSeconds * source.getFps());
+        if (range.begin > 0 && !source.seek(std::max(range.begin - overlap, 0)))
+            throw std::runtime_error("Cannot seek to frame " + std::to_string(range.begin) + " of " + videoPath);
+
+        Result result;
+        result.video = videoPath;
+        result.range = range;
+
+        Session session(assets);
+        session.getOptions().tableFrameEnabled = false;
+        cv::Mat frame, nextFrame;
+        while (source.read(frame))
+        {
+            const int position = source.getPosition() - 1;
+
+            if (isRangeFinished(range, position, session.getScoreCounter()))
+                break;
+
+            if (!source.read(nextFrame))
+                break;
+
+            session.process(frame, nextFrame, position, source.getFps());
+
+            const detection::FoundBallsState &ballsState = session.getBallsState();
+            if (position >= range.begin && position < range.end)
+                result.trajectory.push_back({ position, ballsState.getCenter(), ballsState.getFoundball() });
+
+            source.skip(options.sampler.framesToSkip(ballsState, source.getFps()));
+        }
+
+        // Open-ended range (whole video) finishes where the stream does
+        result.range.end = std::min(range.end, source.getPosition());
+
+        // Events belong to the range in which the ball disappeared, warm-up ones are owned by previous range
+        for (const auto &event : session.getScoreCounter().getEvents())
+            if (event.detectedAt >= range.begin && event.detectedAt < range.end)
+                result.events.push_back(event);
+
+        return result;
+    }
+
+    Result analyzeVideo(const std::string &videoPath, const Assets &assets,
+                        const AnalysisOptions &options, util::ThreadPool &pool, int chunks)
+    {
+        auto index = loadOrBuildIndex(videoPath);
+
+        std::vector<std::future<Result>> futures;
+        for (const video::Segment &range : index->split(chunks))
+            futures.push_back(pool.submit([&, range]() {
+                return analyzeRange(videoPath, index, range, assets, options);
+            }));
+
+        // All chunks have to finish before leaving, as they reference arguments of this function
+        for (auto &future : futures)
+            future.wait();
+
+        std::vector<Result> parts;
+        for (auto &future : futures)
+            parts.push_back(future.get());
+
+        Result result = mergeResults(std::move(parts));
+        result.video = videoPath;
+        return result;
+    }
+} // namespace pipeline
@@ -0,0 +1,53 @@
+#include <stdexcept>
+#include <string>
+
+#include "aruco/aruco.hpp"
+#include "pipeline/assets.hpp"
+
+namespace pipeline
+{
+    Assets loadAssets(const nlohmann::json &config)
+    {
+        Assets assets;
+        // Custom dictionary replaces the one built into the program
+        const std::string dictionaryPath = config.value("arucoDictionaryPath", "");
+        assets.arucoDictionary = dictionaryPath.empty() ? aruco::createEmbeddedDictionary(5)
+                                                        : aruco::createDictionary(dictionaryPath, 5);
+        assets.detectorParameters =
+            aruco::loadParametersFromFile(config.at("arucoDetectorConfigPath").get<std::string>());
+
+        const std::string decoder = config.value("arucoDecoder", "opencv");
+        if (decoder == "table")
+            assets.tableDecoder = std::make_shared<aruco::TableMarkerDecoder>(
+                assets.arucoDictionary, aruco::TABLE_MARKER_IDS, assets.detectorParameters);
+        else if (decoder != "opencv")
+            throw std::invalid_argument("Unknown aruco decoder: " + decoder);
+
+        // Run calibration if calibration file path was not provided
+        auto cameraCalibration = std::make_shared<calibration::CameraCalibration>(
+            config.at("calibInitConfigPath").get<std::string>(), config.at("calibConfigPath").get<std::string>());
+        if (config.at("calibConfigPath").get<std::string>().empty())
+            cameraCalibration->init();
+        assets.cameraCalibration = cameraCalibration;
+
+        assets.tableSize = cv::Size(config.at("gameTableWidth").get<int>(), config.at("gameTableHeight").get<int>());
+        assets.tableMarkerSize = config.value("tableMarkerSize", 0.0f);
+
+        const std::string detectionSpace = config.value("detectionSpace", "table");
+        if (detectionSpace != "table" && detectionSpace != "camera")
+            throw std::invalid_argument("Unknown detection space: " + detectionSpace);
+        assets.cameraSpaceDetection = detectionSpace == "camera";
+
+        if (config.value("lensRefinement", false))
+        {
+            calibration::LensRefinerOptions options;
+            options.markerSize = assets.tableMarkerSize;
+            options.viewInterval = config.value("lensRefinementInterval", options.viewInterval);
+            options.minViewChange = config.value("lensRefinementMinViewChange", options.minViewChange);
+            options.maxViews = config.value("lensRefinementViews", options.maxViews);
+            options.outputPath = config.value("lensRefinementOutputPath", "");
+            assets.lensRefiner = std::make_shared<calibration::LensRefiner>(cameraCalibration, options);
+        }
+        return assets;
+    }
+} // namespace pipeline
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <set>
+
+#include <opencv2/opencv.hpp>
+
+#include "pipeline/batch.hpp"
+#include "util/memoryBudget.hpp"
+
+namespace pipeline
+{
+    namespace
+    {
+        // Frames alive at once in a session: decoded pair, undistorted pair, HSV, masks and annotated copy
+        const int FRAMES_PER_ANALYSIS = 12;
+
+        bool matchesWildcard(const char *pattern, const char *name)
+        {
+            if (*pattern == '\0')
+                return *name == '\0';
+            if (*pattern == '*')
+                return matchesWildcard(pattern + 1, name) || (*name != '\0' && matchesWildcard(pattern, name + 1));
+            if (*name != '\0' && (*pattern == '?' || *pattern == *name))
+                return matchesWildcard(pattern + 1, name + 1);
+            return false;
+        }
+
+        bool isVideoFile(const std::filesystem::path &path)
+        {
+            static const std::set<std::string> extensions = { ".mp4", ".mov", ".avi", ".mkv", ".m4v" };
+            std::string extension = path.extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return extensions.count(extension) > 0;
+        }
+    } // namespace
+
+    std::vector<std::string> expandVideoPaths(const std::vector<std::string> &patterns)
+    {
+        namespace fs = std::filesystem;
+
+        std::vector<std::string> videoPaths;
+        for (const std::string &pattern : patterns)
+        {
+            const fs::path path(pattern);
+            std::vector<std::string> matches;
+            if (fs::is_directory(path))
+            {
+                for (const auto &entry : fs::directory_iterator(path))
+                    if (entry.is_regular_file() && isVideoFile(entry.path()))
+                        matches.push_back(entry.path().string());
+            }
+            else if (pattern.find_first_of("*?") != std::string::npos)
+            {
+                const fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+                const std::string namePattern = path.filename().string();
+                for (const auto &entry : fs::directory_iterator(directory))
+                    if (entry.is_regular_file() &&
+                        matchesWildcard(namePattern.c_str(), entry.path().filename().string().c_str()))
+                        matches.push_back(entry.path().string());
+            }
+            else
+            {
+                matches.push_back(pattern);
+            }
+
+            // Directory order is unspecified, keep batches reproducible
+            std::sort(matches.begin(), matches.end());
+            videoPaths.insert(videoPaths.end(), matches.begin(), matches.end());
+        }
+        return videoPaths;
+    }
+
+    std::string batchResultPath(const std::string &videoPath, const BatchOptions &options)
+    {
+        const std::filesystem::path fileName = std::filesystem::path(videoPath).filename();
+        return (std::filesystem::path(options.outputDirectory) / fileName).string() + ".json";
+    }
+
+    size_t estimateAnalysisMemory(const std::string &videoPath, cv::Size tableSize)
+    {
+        cv::VideoCapture capture(videoPath);
+        const size_t width = static_cast<size_t>(capture.get(cv::CAP_PROP_FRAME_WIDTH));
+        const size_t height = static_cast<size_t>(capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+        return FRAMES_PER_ANALYSIS * 3 * (width * height + static_cast<size_t>(tableSize.area()));
+    }
+
+    BatchSummary analyzeBatch(const std::vector<std::string> &videoPaths, const Assets &assets,
+                              const AnalysisOptions &analysisOptions, const BatchOptions &options,
+                              util::ThreadPool &pool)
+    {
+        std::filesystem::create_directories(options.outputDirectory);
+
+        BatchSummary summary = { 0, 0, 0 };
+        util::MemoryBudget budget(options.memoryBudget);
+        std::mutex outputMutex;
+        std::set<std::string> resultPaths;
+        std::vector<std::future<bool>> futures;
+
+        for (const std::string &videoPath : videoPaths)
+        {
+            const std::string resultPath = batchResultPath(videoPath, options);
+            if (!resultPaths.insert(resultPath).second)
+            {
+                std::cerr << "Skipping " << videoPath << ", another video already writes " << resultPath << '\n';
+                summary.skipped++;
+                continue;
+            }
+
+            // Results are written atomically, so an existing file is always complete
+            if (std::filesystem::exists(resultPath))
+            {
+                summary.skipped++;
+                continue;
+            }
+
+            // Throttles submission, so decoded frames of queued videos never exceed the budget
+            const size_t memory = estimateAnalysisMemory(videoPath, assets.tableSize);
+            budget.acquire(memory);
+
+            futures.push_back(pool.submit([&, videoPath, resultPath, memory]() {
+                bool succeeded = true;
+                try
+                {
+                    const video::Segment wholeVideo = { 0, std::numeric_limits<int>::max() };
+                    writeResult(resultPath, analyzeRange(videoPath, nullptr, wholeVideo, assets, analysisOptions));
+
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cout << "Analyzed " << videoPath << " -> " << resultPath << '\n';
+                }
+                catch (const std::exception &exception)
+                {
+                    succeeded = false;
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cerr << "Failed to analyze " << videoPath << ": " << exception.what() << '\n';
+                }
+                budget.release(memory);
+                return succeeded;
+            }));
+        }
+
+        for (auto &future : futures)
+        {
+            if (future.get())
+                summary.analyzed++;
+            else
+                summary.failed++;
+        }
+        return summary;
+    }
+} // namespace pipeline
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <system_error>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "json.hpp"
+#include "pipeline/jobQueue.hpp"
+
+namespace fs = std::filesystem;
+
+namespace pipeline
+{
+    JobQueue::JobQueue(const std::string &directory, const std::string &workerId,
+                       std::chrono::milliseconds timeout)
+        : directory(directory), workerId(workerId), timeout(timeout)
+    {
+        fs::create_directories(this->directory / "jobs");
+        fs::create_directories(this->directory / "locks");
+        fs::create_directories(this->directory / "results");
+    }
+
+    std::string JobQueue::defaultWorkerId()
+    {
+#ifdef _WIN32
+        const char *host = std::getenv("COMPUTERNAME");
+        const std::string hostName = host ? host : "localhost";
+        const int processId = _getpid();
+#else
+        char host[256] = {};
+        const std::string hostName = gethostname(host, sizeof(host) - 1) == 0 ? host : "localhost";
+        const int processId = static_cast<int>(getpid());
+#endif
+        return hostName + "-" + std::to_string(processId);
+    }
+
+    fs::path JobQueue::jobPath(const std::string &name) const
+    {
+        return directory / "jobs" / (name + ".json");
+    }
+
+    fs::path JobQueue::lockPath(const std::string &name) const
+    {
+        return directory / "locks" / (name + ".lock");
+    }
+
+    bool JobQueue::isStale(const fs::path &lock) const
+    {
+        std::error_code error;
+        const auto heartbeat = fs::last_write_time(lock, error);
+        return !error && fs::file_time_type::clock::now() - heartbeat > timeout;
+    }
+
+    bool JobQueue::isOwnLock(const fs::path &lock) const
+    {
+        std::ifstream file(lock);
+        std::string owner;
+        std::getline(file, owner);
+        return owner == workerId;
+    }
+
+    void JobQueue::add(const Job &job)
+    {
+        const fs::path path = jobPath(job.name);
+        if (fs::exists(path))
+            return;
+
+        const nlohmann::json description = { { "video", job.video },
+                                             { "begin", job.range.begin },
+                                             { "end", job.range.end } };
+        const fs::path temporaryPath = path.string() + ".tmp";
+        {
+            std::ofstream file(temporaryPath);
+            file << std::setw(4) << description << '\n';
+            if (!file)
+                throw fs::filesystem_error("Cannot write job file", path, std::make_error_code(std::errc::io_error));
+        }
+        fs::rename(temporaryPath, path);
+    }
+
+    std::vector<Job> JobQueue::getJobs() const
+    {
+        std::vector<Job> jobs;
+        for (const auto &entry : fs::directory_iterator(directory / "jobs"))
+        {
+            if (entry.path().extension() != ".json")
+                continue;
+
+            std::ifstream file(entry.path());
+            const nlohmann::json description = nlohmann::json::parse(file);
+            jobs.push_back({ entry.path().stem().string(),
+                             description.at("video").get<std::string>(),
+                             { description.at("begin").get<int>(), description.at("end").get<int>() } });
+        }
+
+        // Every worker walks the queue in the same order, so parts of one video finish close together
+        std::sort(jobs.begin(), jobs.end(), [](const Job &a, const Job &b) { return a.name < b.name; });
+        return jobs;
+    }
+
+    std::string JobQueue::resultPath(const Job &job) const
+    {
+        return (directory / "results" / (job.name + ".json")).string();
+    }
+
+    bool JobQueue::isDone(const Job &job) const
+    {
+        return fs::exists(resultPath(job));
+    }
+
+    bool JobQueue::isFailed(const Job &job) const
+    {
+        return fs::exists(directory / "results" / (job.name + ".error"));
+    }
+
+    bool JobQueue::isFinished() const
+    {
+        const std::vector<Job> jobs = getJobs();
+        return std::all_of(jobs.begin(), jobs.end(),
+                           [this](const Job &job) { return isDone(job) || isFailed(job); });
+    }
+
+    bool JobQueue::claim(const Job &job)
+    {
+        // Exclusive creation is the only atomic test-and-set every shared filesystem offers
+        std::FILE *lock = std::fopen(lockPath(job.name).string().c_str(), "wx");
+        if (!lock)
+            return false;
+        std::fputs(workerId.c_str(), lock);
+        std::fclose(lock);
+
+        // Job could be finished by another worker between listing the queue and taking the lock
+        if (isDone(job))
+        {
+            release(job);
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<Job> JobQueue::claimNext()
+    {
+        for (const Job &job : getJobs())
+            if (!isDone(job) && !isFailed(job) && claim(job))
+                return job;
+        return std::nullopt;
+    }
+
+    void JobQueue::heartbeat(const Job &job)
+    {
+        std::error_code error;
+        fs::last_write_time(lockPath(job.name), fs::file_time_type::clock::now(), error);
+    }
+
+    void JobQueue::complete(const Job &job, const Result &result)
+    {
+        writeResult(resultPath(job), result);
+        release(job);
+    }
+
+    void JobQueue::fail(const Job &job, const std::string &reason)
+    {
+        std::ofstream(directory / "results" / (job.name + ".error")) << workerId << ": " << reason << '\n';
+        release(job);
+    }
+
+    void JobQueue::release(const Job &job)
+    {
+        const fs::path lock = lockPath(job.name);
+        if (!isOwnLock(lock))
+            return;
+
+        // Lock is moved aside before removing, one claimed by another worker since the check is put back
+        std::error_code error;
+        const fs::path released = lock.string() + "." + workerId + ".released";
+        fs::rename(lock, released, error);
+        if (error)
+            return;
+        if (!isOwnLock(released))
+            fs::create_hard_link(released, lock, error);
+        fs::remove(released, error);
+    }
+
+    int JobQueue::requeueStale()
+    {
+        int requeued = 0;
+        for (const auto &entry : fs::directory_iterator(directory / "locks"))
+        {
+            const fs::path lock = entry.path();
+            if (lock.extension() != ".lock" || !isStale(lock))
+                continue;
+
+            // Rename succeeds for exactly one of the workers which noticed the same stale lock
+            std::error_code error;
+            const fs::path broken = lock.string() + "." + workerId;
+            fs::rename(lock, broken, error);
+            if (error)
+                continue;
+
+            // Owner refreshed the lock meanwhile, give it back unless somebody claimed the job already
+            if (!isStale(broken))
+                fs::create_hard_link(broken, lock, error);
+            else
+                requeued++;
+            fs::remove(broken, error);
+        }
+        return requeued;
+    }
+} // namespace pipeline
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "pipeline/result.hpp"
+
+namespace pipeline
+{
+    using EventType = detection::ScoreCounter::LastEventType;
+
+    static std::string eventName(EventType type)
+    {
+        switch (type)
+        {
+            case EventType::EV_OUT:
+                return "out";
+            case EventType::EV_GOOL_LEFT:
+                return "goal_left";
+            case EventType::EV_GOOL_RIGHT:
+                return "goal_right";
+            default:
+                return "none";
+        }
+    }
+
+    static EventType eventFromName(const std::string &name)
+    {
+        if (name == "out")
+            return EventType::EV_OUT;
+        if (name == "goal_left")
+            return EventType::EV_GOOL_LEFT;
+        if (name == "goal_right")
+            return EventType::EV_GOOL_RIGHT;
+        throw std::invalid_argument("Unknown score event: " + name);
+    }
+
+    nlohmann::json toJson(const Result &result)
+    {
+        nlohmann::json json;
+        json["video"] = result.video;
+        json["range"] = { result.range.begin, result.range.end };
+
+        int left = 0, right = 0, outs = 0;
+        json["events"] = nlohmann::json::array();
+        for (const auto &event : result.events)
+        {
+            json["events"].push_back({ { "type", eventName(event.type) },
+                                       { "detectedAt", event.detectedAt },
+                                       { "confirmedAt", event.confirmedAt } });
+            left += event.type == EventType::EV_GOOL_LEFT;
+            right += event.type == EventType::EV_GOOL_RIGHT;
+            outs += event.type == EventType::EV_OUT;
+        }
+        json["score"] = { { "left", left }, { "right", right }, { "outs", outs } };
+
+        // Trajectory is the bulk of the file, so every point is a compact [frame, x, y, found] array
+        json["trajectory"] = nlohmann::json::array();
+        for (const TrajectoryPoint &point : result.trajectory)
+            json["trajectory"].push_back({ point.frame, point.position.x, point.position.y, point.found });
+        return json;
+    }
+
+    Result resultFromJson(const nlohmann::json &json)
+    {
+        Result result;
+        result.video = json.at("video").get<std::string>();
+        result.range = { json.at("range")[0].get<int>(), json.at("range")[1].get<int>() };
+
+        for (const auto &event : json.at("events"))
+            result.events.push_back({ eventFromName(event.at("type").get<std::string>()),
+                                      event.at("detectedAt").get<int>(),
+                                      event.at("confirmedAt").get<int>() });
+
+        for (const auto &point : json.at("trajectory"))
+            result.trajectory.push_back({ point[0].get<int>(),
+                                          cv::Point(point[1].get<int>(), point[2].get<int>()),
+                                          point[3].get<bool>() });
+        return result;
+    }
+
+    void writeResult(const std::string &path, const Result &result)
+    {
+        const std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath);
+            file << toJson(result) << '\n';
+            if (!file)
+                throw std::filesystem::filesystem_error(
+                    "Cannot write result file " + path, std::make_error_code(std::errc::io_error));
+        }
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    Result readResult(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+            throw std::filesystem::filesystem_error(
+                "Cannot open result file " + path,
+                std::make_error_code(std::errc::no_such_file_or_directory));
+
+        return resultFromJson(nlohmann::json::parse(file));
+    }
+
+    Result mergeResults(std::vector<Result> parts)
+    {
+        Result merged;
+        if (parts.empty())
+            return merged;
+
+        std::sort(parts.begin(), parts.end(),
+                  [](const Result &a, const Result &b) { return a.range.begin < b.range.begin; });
+
+        merged.video = parts.front().video;
+        merged.range = { parts.front().range.begin, parts.back().range.end };
+        for (const Result &part : parts)
+        {
+            merged.trajectory.insert(merged.trajectory.end(), part.trajectory.begin(), part.trajectory.end());
+            merged.events.insert(merged.events.end(), part.events.begin(), part.events.end());
+        }
+        return merged;
+    }
+} // namespace pipeline
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "pipeline/scheduler.hpp"
+
+namespace pipeline
+{
+    Scheduler::Scheduler(const Assets &assets, const AnalysisOptions &options, util::ThreadPool &pool)
+        : assets(assets), options(options), pool(pool), runningStreams(0) {}
+
+    void Scheduler::addStream(const std::string &path)
+    {
+        auto stream = std::make_unique<Stream>(path, assets);
+        if (!stream->source.isOpened())
+            throw std::runtime_error("Cannot open video stream " + path);
+
+        stream->result.video = path;
+        stream->result.range = { 0, 0 };
+        streams.push_back(std::move(stream));
+    }
+
+    void Scheduler::schedule(Stream &stream)
+    {
+        pool.submit([this, &stream]() {
+            bool running = false;
+            try
+            {
+                running = step(stream);
+            }
+            catch (const std::exception &exception)
+            {
+                std::cerr << "Stream " << stream.result.video << " stopped: " << exception.what() << '\n';
+            }
+
+            if (running)
+            {
+                schedule(stream);
+                return;
+            }
+
+            stream.result.range.end = stream.source.getPosition();
+            stream.result.events = stream.session.getScoreCounter().getEvents();
+            // Notified under the lock, as run() may return and destroy the scheduler right after
+            std::lock_guard<std::mutex> lock(mutex);
+            runningStreams--;
+            streamFinished.notify_all();
+        });
+    }
+
+    bool Scheduler::step(Stream &stream)
+    {
+        cv::Mat frame, nextFrame;
+        for (int i = 0; i < PAIRS_PER_STEP; i++)
+        {
+            if (!stream.source.read(frame))
+                return false;
+            const int position = stream.source.getPosition() - 1;
+            if (!stream.source.read(nextFrame))
+                return false;
+
+            stream.session.process(frame, nextFrame, position, stream.source.getFps());
+
+            const detection::FoundBallsState &ballsState = stream.session.getBallsState();
+            stream.result.trajectory.push_back({ position, ballsState.getCenter(), ballsState.getFoundball() });
+            stream.source.skip(options.sampler.framesToSkip(ballsState, stream.source.getFps()));
+        }
+        return true;
+    }
+
+    std::vector<Result> Scheduler::run()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            runningStreams = streams.size();
+        }
+        for (auto &stream : streams)
+            schedule(*stream);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        streamFinished.wait(lock, [this]() { return runningStreams == 0; });
+
+        std::vector<Result> results;
+        for (auto &stream : streams)
+            results.push_back(std::move(stream->result));
+        return results;
+    }
+} // namespace pipeline
@@ -0,0 +1,121 @@
+#include "pipeline/session.hpp"
+
+namespace pipeline
+{
+    Session::Session(const Assets &assets)
+        : assets(assets),
+          table(assets.tableSize.width, assets.tableSize.height),
+          ballsState(0.0, false, 0),
+          scoreCounter(table.getSize(), 24),
+          processedCount(0),
+          foundCount(0),
+          detections(std::in_place),
+          frameAllocator(nullptr) {}
+
+    void Session::detectMarkers(const cv::Mat &frame)
+    {
+        if (assets.tableDecoder)
+            assets.tableDecoder->detect(frame, found, arucoBuffers);
+        else
+            aruco::detectArucoOnFrame(frame, assets.arucoDictionary, found, assets.detectorParameters, arucoBuffers);
+    }
+
+    void Session::addLensRefinementView(cv::Size frameSize, uint64_t calibrationGeneration)
+    {
+        if (!options.lensRefinementEnabled || !assets.lensRefiner)
+            return;
+        if (table.getMarkerCorrespondences(found, assets.tableMarkerSize, markerObjectPoints, markerImagePoints))
+            assets.lensRefiner->addView(markerObjectPoints, markerImagePoints, frameSize, calibrationGeneration);
+    }
+
+    void Session::detectOnTableFrames(double deltaTicks, detection::DebugSink *debugSink)
+    {
+        if (options.trackingEnabled)
+        {
+            detection::trackBallOnFrames(ballsState, deltaTicks, tableFrame, nextTableFrame, detections->ball,
+                                         debugSink);
+            if (!detections->ball.boxes.empty())
+                foundCount++;
+            processedCount++;
+        }
+        if (options.redDetectionEnabled)
+            detection::detectPlayersOnFrame(detection::Mode::RED_PLAYERS, redPlayersFinder, tableFrame,
+                                            detections->redPlayers, debugSink);
+        if (options.blueDetectionEnabled)
+            detection::detectPlayersOnFrame(detection::Mode::BLUE_PLAYERS, bluePlayersFinder, tableFrame,
+                                            detections->bluePlayers, debugSink);
+    }
+
+    void Session::detectInCameraRegion(double deltaTicks, detection::DebugSink *debugSink)
+    {
+        if (options.trackingEnabled)
+        {
+            detection::trackBallInRegion(ballsState, deltaTicks, undistortedFrame, undistortedNextFrame, cameraRegion,
+                                         detections->ball, debugSink);
+            if (!detections->ball.boxes.empty())
+                foundCount++;
+            processedCount++;
+        }
+        if (options.redDetectionEnabled)
+            detection::detectPlayersInRegion(detection::Mode::RED_PLAYERS, redPlayersFinder, undistortedFrame,
+                                             cameraRegion, detections->redPlayers, debugSink);
+        if (options.blueDetectionEnabled)
+            detection::detectPlayersInRegion(detection::Mode::BLUE_PLAYERS, bluePlayersFinder, undistortedFrame,
+                                             cameraRegion, detections->bluePlayers, debugSink);
+    }
+
+    const detection::FrameDetections &Session::process(const cv::Mat &frame, const cv::Mat &nextFrame, int position, double fps,
+                                                       detection::DebugSink *debugSink)
+    {
+        // Kalman filter runs in video time, so skipped frames are taken into account
+        const double precTick = ballsState.getTicks();
+        ballsState.setTicks(position / fps);
+        const double deltaTicks = ballsState.getTicks() - precTick;
+
+        for (cv::Mat *output : { &undistortedFrame, &undistortedNextFrame, &tableFrame, &nextTableFrame })
+            util::leaseBuffer(*output, frameAllocator);
+
+        const uint64_t calibrationGeneration = assets.cameraCalibration->undistort(frame, undistortedFrame);
+        assets.cameraCalibration->undistort(nextFrame, undistortedNextFrame);
+
+        // Detections of previous frame live in the arena, so they are dropped before it is reset
+        detections.reset();
+        arena.reset();
+        detections.emplace(arena.get());
+
+        detectMarkers(undistortedFrame);
+        table.updateTableOnFrame(found);
+        const bool frameHasTable = table.hasTable();
+        if (frameHasTable && !assets.cameraSpaceDetection)
+            table.getTableFromFrame(undistortedFrame, tableFrame);
+        addLensRefinementView(frame.size(), calibrationGeneration);
+
+        detectMarkers(undistortedNextFrame);
+        table.updateTableOnFrame(found);
+
+        if (!table.hasTable())
+        {
+            // Masks and sizes of detection make sense only on the table, whole frame is just shown
+            if (options.tableFrameEnabled)
+                undistortedFrame.copyTo(tableFrame);
+        }
+        else if (assets.cameraSpaceDetection && table.updateCameraRegion(undistortedFrame.size(), cameraRegion))
+        {
+            // Both frames are searched with the table of the later one, it moves little between them
+            if (options.tableFrameEnabled)
+                table.getTableFromFrame(undistortedFrame, tableFrame);
+            detectInCameraRegion(deltaTicks, debugSink);
+        }
+        else
+        {
+            // Table may have been found only on the second frame
+            if (!frameHasTable || assets.cameraSpaceDetection)
+                table.getTableFromFrame(undistortedFrame, tableFrame);
+            table.getTableFromFrame(undistortedNextFrame, nextTableFrame);
+            detectOnTableFrames(deltaTicks, debugSink);
+        }
+
+        scoreCounter.trackBallAndScore(ballsState.getCenter(), ballsState.getFoundball(), position);
+        return *detections;
+    }
+} // namespace pipeline
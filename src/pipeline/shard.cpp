@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "pipeline/batch.hpp"
+#include "pipeline/shard.hpp"
+#include "util/threadPool.hpp"
+
+namespace pipeline
+{
+    int enqueueVideos(JobQueue &queue, const std::vector<std::string> &videoPaths, int chunks)
+    {
+        int added = 0;
+        for (const std::string &videoPath : videoPaths)
+        {
+            const std::string fileName = std::filesystem::path(videoPath).filename().string();
+
+            // Single job reads whole video sequentially, chunks need keyframe index to seek
+            std::vector<video::Segment> ranges = { { 0, std::numeric_limits<int>::max() } };
+            if (chunks > 1)
+                ranges = loadOrBuildIndex(videoPath)->split(chunks);
+
+            for (size_t part = 0; part < ranges.size(); part++)
+            {
+                char suffix[16];
+                std::snprintf(suffix, sizeof(suffix), ".%03d", static_cast<int>(part));
+                queue.add({ fileName + suffix, std::filesystem::absolute(videoPath).string(), ranges[part] });
+                added++;
+            }
+        }
+        return added;
+    }
+
+    void runShardWorker(JobQueue &queue, const Assets &assets, const AnalysisOptions &options,
+                        int threads, std::chrono::milliseconds heartbeatPeriod)
+    {
+        std::mutex outputMutex;
+        util::ThreadPool pool(threads);
+        std::vector<std::future<void>> workers;
+        for (size_t i = 0; i < pool.size(); i++)
+            workers.push_back(pool.submit([&]() {
+                while (!queue.isFinished())
+                {
+                    queue.requeueStale();
+                    const std::optional<Job> job = queue.claimNext();
+                    if (!job)
+                    {
+                        // Remaining jobs are running elsewhere, wait in case their workers die
+                        std::this_thread::sleep_for(heartbeatPeriod);
+                        continue;
+                    }
+
+                    auto analysis = std::async(std::launch::async, [&]() {
+                        // Keyframe index was built by enqueue, chunks starting later use it to seek
+                        auto index = job->range.begin > 0 ? loadOrBuildIndex(job->video) : nullptr;
+                        return analyzeRange(job->video, index, job->range, assets, options);
+                    });
+                    while (analysis.wait_for(heartbeatPeriod) != std::future_status::ready)
+                        queue.heartbeat(*job);
+
+                    try
+                    {
+                        queue.complete(*job, analysis.get());
+                        std::lock_guard<std::mutex> lock(outputMutex);
+                        std::cout << "Finished job " << job->name << '\n';
+                    }
+                    catch (const std::exception &exception)
+                    {
+                        queue.fail(*job, exception.what());
+                        std::lock_guard<std::mutex> lock(outputMutex);
+                        std::cerr << "Job " << job->name << " failed: " << exception.what() << '\n';
+                    }
+                }
+            }));
+
+        for (auto &worker : workers)
+            worker.get();
+    }
+
+    int mergeShardResults(const JobQueue &queue, const std::string &outputDirectory)
+    {
+        std::map<std::string, std::vector<Job>> jobsOfVideos;
+        for (const Job &job : queue.getJobs())
+            jobsOfVideos[job.video].push_back(job);
+
+        std::filesystem::create_directories(outputDirectory);
+        const BatchOptions batchOptions = { outputDirectory, 0 };
+
+        int merged = 0;
+        for (const auto &[videoPath, jobs] : jobsOfVideos)
+        {
+            std::vector<Result> parts;
+            for (const Job &job : jobs)
+                if (queue.isDone(job))
+                    parts.push_back(readResult(queue.resultPath(job)));
+
+            if (parts.size() < jobs.size())
+            {
+                std::cout << videoPath << ": " << parts.size() << " of " << jobs.size() << " jobs done\n";
+                continue;
+            }
+
+            Result result = mergeResults(std::move(parts));
+            result.video = videoPath;
+            writeResult(batchResultPath(videoPath, batchOptions), result);
+            merged++;
+        }
+        return merged;
+    }
+} // namespace pipeline
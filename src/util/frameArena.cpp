@@ -0,0 +1,41 @@
+#include "util/frameArena.hpp"
+
+namespace util
+{
+    void *FrameArena::Upstream::do_allocate(size_t bytes, size_t alignment)
+    {
+        frameBytes += bytes;
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void FrameArena::Upstream::do_deallocate(void *pointer, size_t bytes, size_t alignment)
+    {
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    bool FrameArena::Upstream::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+    {
+        return this == &other;
+    }
+
+    FrameArena::FrameArena(size_t capacity)
+        : capacity(capacity), buffer(std::make_unique<std::byte[]>(capacity))
+    {
+        resource.emplace(buffer.get(), capacity, &upstream);
+    }
+
+    void FrameArena::reset()
+    {
+        resource->release();
+        if (upstream.frameBytes > 0)
+        {
+            // Next frames of the same size fit into the buffer
+            capacity += upstream.frameBytes;
+            resource.reset();
+            buffer = std::make_unique<std::byte[]>(capacity);
+            resource.emplace(buffer.get(), capacity, &upstream);
+        }
+        upstream.frameBytes = 0;
+    }
+} // namespace util
@@ -0,0 +1,188 @@
+#include <new>
+
+#include "util/framePool.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace util
+{
+    namespace
+    {
+        size_t systemPageSize()
+        {
+#ifdef _WIN32
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        const size_t HUGE_PAGE_SIZE = 2 << 20;
+    } // namespace
+
+    FramePool::FramePool(cv::Size inputSize, cv::Size tableSize, size_t buffersPerSize, bool hugePages)
+        : pageSize(hugePages ? HUGE_PAGE_SIZE : systemPageSize()),
+          buffersPerSize(buffersPerSize),
+          hugePages(hugePages),
+          allocations(0),
+          reuses(0)
+    {
+        // Color frames of both sizes go through every stage, fill the pool with them up front
+        for (const cv::Size &size : { inputSize, tableSize })
+        {
+            if (size.area() <= 0)
+                continue;
+
+            const size_t bytes = roundToPages(static_cast<size_t>(size.area()) * 3);
+            auto &buffers = freeBuffers[bytes];
+            while (buffers.size() < buffersPerSize)
+                buffers.push_back(mapBuffer(bytes));
+        }
+    }
+
+    FramePool::~FramePool()
+    {
+        for (auto &[bytes, buffers] : freeBuffers)
+            for (void *buffer : buffers)
+                unmapBuffer(buffer, bytes);
+    }
+
+    size_t FramePool::roundToPages(size_t bytes) const
+    {
+        return (bytes + pageSize - 1) / pageSize * pageSize;
+    }
+
+    void *FramePool::mapBuffer(size_t bytes) const
+    {
+#ifdef _WIN32
+        void *buffer = VirtualAlloc(nullptr, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!buffer)
+            throw std::bad_alloc();
+#else
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+        // Fault pages in now, not in the middle of a frame
+        flags |= MAP_POPULATE;
+#endif
+        void *buffer = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (hugePages)
+            buffer = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+#endif
+        if (buffer == MAP_FAILED)
+        {
+            // No reserved huge pages, transparent ones are the next best thing
+            buffer = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (buffer == MAP_FAILED)
+                throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            if (hugePages)
+                madvise(buffer, bytes, MADV_HUGEPAGE);
+#endif
+        }
+#endif
+        allocations++;
+        return buffer;
+    }
+
+    void FramePool::unmapBuffer(void *buffer, size_t bytes) const
+    {
+#ifdef _WIN32
+        (void)bytes;
+        VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+        munmap(buffer, bytes);
+#endif
+    }
+
+    void *FramePool::acquire(size_t bytes) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto buffers = freeBuffers.find(bytes);
+            if (buffers != freeBuffers.end() && !buffers->second.empty())
+            {
+                void *buffer = buffers->second.back();
+                buffers->second.pop_back();
+                reuses++;
+                return buffer;
+            }
+        }
+        return mapBuffer(bytes);
+    }
+
+    void FramePool::release(void *buffer, size_t bytes) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &buffers = freeBuffers[bytes];
+            if (buffers.size() < buffersPerSize)
+            {
+                buffers.push_back(buffer);
+                return;
+            }
+        }
+        unmapBuffer(buffer, bytes);
+    }
+
+    cv::UMatData *FramePool::allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags,
+                                      cv::UMatUsageFlags usageFlags) const
+    {
+        // Same layout as OpenCV's own allocator: continuous rows, steps computed from the last dimension
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--)
+        {
+            if (step)
+            {
+                if (data && step[i] != CV_AUTOSTEP)
+                    total = step[i];
+                else
+                    step[i] = total;
+            }
+            total *= sizes[i];
+        }
+
+        cv::UMatData *u = new cv::UMatData(this);
+        if (data)
+        {
+            u->data = u->origdata = static_cast<unsigned char *>(data);
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        }
+        else
+        {
+            u->data = u->origdata = static_cast<unsigned char *>(acquire(roundToPages(total)));
+        }
+        u->size = total;
+        return u;
+    }
+
+    bool FramePool::allocate(cv::UMatData *data, int, cv::UMatUsageFlags) const
+    {
+        return data != nullptr;
+    }
+
+    void FramePool::deallocate(cv::UMatData *data) const
+    {
+        if (!data)
+            return;
+
+        if (!(data->flags & cv::UMatData::USER_ALLOCATED))
+            release(data->origdata, roundToPages(data->size));
+        delete data;
+    }
+
+    void leaseBuffer(cv::Mat &mat, cv::MatAllocator *allocator)
+    {
+        if (mat.u && mat.u->refcount > 1)
+            mat.release();
+        mat.allocator = allocator;
+    }
+} // namespace util
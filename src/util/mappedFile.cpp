@@ -0,0 +1,94 @@
+#include <filesystem>
+
+#include "util/mappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util
+{
+    static std::filesystem::filesystem_error cannotMap(const std::string &path)
+    {
+        return std::filesystem::filesystem_error(
+            "Cannot map file " + path, std::make_error_code(std::errc::io_error));
+    }
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string &path)
+        : data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+    {
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            throw cannotMap(path);
+
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(fileHandle, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size == 0)
+            return;
+
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle)
+            data = static_cast<const uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!data)
+        {
+            if (mappingHandle)
+                CloseHandle(mappingHandle);
+            CloseHandle(fileHandle);
+            throw cannotMap(path);
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data)
+            UnmapViewOfFile(data);
+        if (mappingHandle)
+            CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+    }
+#else
+    MappedFile::MappedFile(const std::string &path) : data(nullptr), size(0)
+    {
+        const int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            throw cannotMap(path);
+
+        struct stat status;
+        if (fstat(descriptor, &status) != 0)
+        {
+            close(descriptor);
+            throw cannotMap(path);
+        }
+
+        size = static_cast<size_t>(status.st_size);
+        if (size > 0)
+        {
+            void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+            if (mapping == MAP_FAILED)
+            {
+                close(descriptor);
+                throw cannotMap(path);
+            }
+            data = static_cast<const uint8_t *>(mapping);
+        }
+
+        // Mapping stays valid after descriptor is closed
+        close(descriptor);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data)
+            munmap(const_cast<uint8_t *>(data), size);
+    }
+#endif
+} // namespace util
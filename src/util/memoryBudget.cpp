@@ -0,0 +1,30 @@
+#include "util/memoryBudget.hpp"
+
+namespace util
+{
+    MemoryBudget::MemoryBudget(size_t limit) : limit(limit), used(0)
+    {
+    }
+
+    void MemoryBudget::acquire(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&]() { return used == 0 || used + bytes <= limit; });
+        used += bytes;
+    }
+
+    void MemoryBudget::release(size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            used -= bytes;
+        }
+        released.notify_all();
+    }
+
+    size_t MemoryBudget::getUsed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+} // namespace util
@@ -0,0 +1,47 @@
+#include <algorithm>
+
+#include "util/threadPool.hpp"
+
+namespace util
+{
+    ThreadPool::ThreadPool(size_t threads) : stopping(false)
+    {
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back(&ThreadPool::work, this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+
+        // Remaining tasks are still executed, so no future is left without value
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    void ThreadPool::work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+} // namespace util
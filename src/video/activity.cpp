@@ -0,0 +1,139 @@
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+#include "json.hpp"
+#include "video/activity.hpp"
+
+namespace video
+{
+    std::vector<Segment> readSegments(const std::string &path, const std::string &videoPath)
+    {
+        std::vector<Segment> segments;
+        std::ifstream file(path);
+        if (!file.is_open())
+            return segments;
+
+        nlohmann::json content = nlohmann::json::parse(file);
+        if (content["video"].get<std::string>() != videoPath)
+            return segments;
+
+        for (const auto &segment : content["segments"])
+            segments.push_back({ segment["begin"].get<int>(), segment["end"].get<int>() });
+        return segments;
+    }
+
+    void writeSegments(const std::string &path, const std::string &videoPath,
+                       const std::vector<Segment> &segments)
+    {
+        nlohmann::json content;
+        content["video"] = videoPath;
+        content["segments"] = nlohmann::json::array();
+        for (const Segment &segment : segments)
+            content["segments"].push_back({ { "begin", segment.begin }, { "end", segment.end } });
+
+        std::ofstream file(path);
+        if (!file.is_open())
+            throw std::filesystem::filesystem_error(
+                "Cannot write segments file " + path,
+                std::make_error_code(std::errc::permission_denied));
+        file << std::setw(4) << content << '\n';
+    }
+
+    bool ActivityDetector::isActive(const cv::Mat &frame, const cv::Rect &roi)
+    {
+        const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+        const cv::Rect region = roi.area() > 0 ? roi & frameRect : frameRect;
+
+        // Downscale first, so color conversion and differencing touch only a few pixels
+        cv::resize(frame(region), small, probeSize, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, current, cv::COLOR_BGR2GRAY);
+
+        // First probe only becomes the baseline, nothing can be said about motion yet
+        if (previous.empty())
+        {
+            current.copyTo(previous);
+            return false;
+        }
+
+        cv::absdiff(current, previous, difference);
+        cv::threshold(difference, difference, 20, 255, cv::THRESH_BINARY);
+        std::swap(current, previous);
+
+        return cv::countNonZero(difference) > activeFraction * probeSize.area();
+    }
+
+    ActivityMonitor::ActivityMonitor(int idleFrames, int fastForwardStep, double activeFraction)
+        : detector(cv::Size(64, 32), activeFraction),
+          idleFrames(idleFrames),
+          fastForwardStep(std::max(fastForwardStep, 1)),
+          segmentOpen(true),
+          segmentBegin(0),
+          lastActive(0) {}
+
+    bool ActivityMonitor::update(const cv::Mat &frame, const cv::Rect &roi, int position,
+                                 bool ballFound)
+    {
+        if (!isDetecting())
+            return false;
+
+        if (detector.isActive(frame, roi) || ballFound)
+            lastActive = position;
+
+        if (position - lastActive < idleFrames)
+            return false;
+
+        segments.push_back({ segmentBegin, lastActive + 1 });
+        segmentOpen = false;
+        return true;
+    }
+
+    bool ActivityMonitor::fastForward(FrameSource &source, const cv::Rect &roi)
+    {
+        detector.reset();
+        for (;;)
+        {
+            if (!source.skip(fastForwardStep - 1) || !source.read(probe))
+                return false;
+
+            if (detector.isActive(probe, roi))
+                break;
+        }
+
+        // Activity started somewhere within the last step, go back so nothing is missed
+        const int resumeAt = std::max(source.getPosition() - fastForwardStep, 0);
+        if (!source.seek(resumeAt))
+            return false;
+
+        detector.reset();
+        segmentOpen = true;
+        segmentBegin = lastActive = resumeAt;
+        return true;
+    }
+
+    bool ActivityMonitor::skipIdle(FrameSource &source) const
+    {
+        if (knownSegments.empty())
+            return true;
+
+        const int position = source.getPosition();
+        for (const Segment &segment : knownSegments)
+        {
+            if (position < segment.begin)
+                return source.seek(segment.begin);
+            if (position < segment.end)
+                return true;
+        }
+        return false;
+    }
+
+    const std::vector<Segment> &ActivityMonitor::finish(int position)
+    {
+        if (isDetecting() && segmentOpen)
+        {
+            segments.push_back({ segmentBegin, position });
+            segmentOpen = false;
+        }
+        return segments;
+    }
+} // namespace video
@@ -0,0 +1,43 @@
+#include "video/frameSource.hpp"
+
+namespace video
+{
+    FrameSource::FrameSource(const std::string &path) : capture(path), position(0)
+    {
+        fps = capture.get(cv::CAP_PROP_FPS);
+        if (fps <= 0.0)
+            fps = DEFAULT_FPS;
+        frameSize = cv::Size(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                             static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    }
+
+    bool FrameSource::read(cv::Mat &frame)
+    {
+        if (!capture.read(frame))
+            return false;
+
+        ++position;
+        return true;
+    }
+
+    bool FrameSource::skip(int frames)
+    {
+        for (int i = 0; i < frames; ++i)
+        {
+            if (!capture.grab())
+                return false;
+            ++position;
+        }
+        return true;
+    }
+
+    bool FrameSource::seek(int frame)
+    {
+        const int keyframe = index ? index->keyframeAtOrBefore(frame) : frame;
+        if (!capture.set(cv::CAP_PROP_POS_FRAMES, keyframe))
+            return false;
+
+        position = keyframe;
+        return skip(frame - keyframe);
+    }
+} // namespace video
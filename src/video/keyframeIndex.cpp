@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <opencv2/opencv.hpp>
+
+#include "video/keyframeIndex.hpp"
+
+namespace video
+{
+    /*
+     * Minimal reader of ISO base media file format (MP4/MOV) sample tables. Only the first video
+     * track is used and fragmented files are not supported.
+     */
+    namespace mp4
+    {
+        struct Box
+        {
+            std::string type;
+            const uint8_t *body;
+            uint64_t size;
+        };
+
+        static uint32_t readU32(const uint8_t *p)
+        {
+            return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+
+        static uint64_t readU64(const uint8_t *p)
+        {
+            return (uint64_t(readU32(p)) << 32) | readU32(p + 4);
+        }
+
+        static std::vector<Box> children(const uint8_t *data, uint64_t size)
+        {
+            std::vector<Box> boxes;
+            uint64_t offset = 0;
+            while (offset + 8 <= size)
+            {
+                uint64_t boxSize = readU32(data + offset);
+                uint64_t headerSize = 8;
+                if (boxSize == 1 && offset + 16 <= size)
+                {
+                    boxSize = readU64(data + offset + 8);
+                    headerSize = 16;
+                }
+                else if (boxSize == 0)
+                    boxSize = size - offset;
+
+                if (boxSize < headerSize || boxSize > size - offset)
+                    break;
+
+                boxes.push_back({ std::string(reinterpret_cast<const char *>(data + offset + 4), 4),
+                                  data + offset + headerSize, boxSize - headerSize });
+                offset += boxSize;
+            }
+            return boxes;
+        }
+
+        static std::optional<Box> find(const std::vector<Box> &boxes, const char *type)
+        {
+            for (const Box &box : boxes)
+                if (box.type == type)
+                    return box;
+            return std::nullopt;
+        }
+
+        static std::optional<Box> findPath(const Box &root, std::initializer_list<const char *> path)
+        {
+            std::optional<Box> box = root;
+            for (const char *type : path)
+            {
+                box = find(children(box->body, box->size), type);
+                if (!box)
+                    break;
+            }
+            return box;
+        }
+
+        // Reads "full box" table: version and flags, entry count and fixed-size entries
+        static std::vector<const uint8_t *> tableEntries(const Box &box, uint64_t entrySize)
+        {
+            std::vector<const uint8_t *> entries;
+            if (box.size < 8)
+                return entries;
+
+            const uint64_t count = std::min<uint64_t>(readU32(box.body + 4), (box.size - 8) / entrySize);
+            entries.reserve(count);
+            for (uint64_t i = 0; i < count; ++i)
+                entries.push_back(box.body + 8 + i * entrySize);
+            return entries;
+        }
+
+        static std::vector<uint8_t> readMovieBox(const std::string &path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            uint8_t header[16];
+            uint64_t offset = 0;
+
+            // Top-level boxes are walked without reading media data, which may be gigabytes long
+            while (file.read(reinterpret_cast<char *>(header), 8))
+            {
+                uint64_t boxSize = readU32(header);
+                uint64_t headerSize = 8;
+                if (boxSize == 1)
+                {
+                    if (!file.read(reinterpret_cast<char *>(header + 8), 8))
+                        break;
+                    boxSize = readU64(header + 8);
+                    headerSize = 16;
+                }
+                if (boxSize < headerSize)
+                    break;
+
+                if (std::memcmp(header + 4, "moov", 4) == 0)
+                {
+                    std::vector<uint8_t> body(boxSize - headerSize);
+                    file.read(reinterpret_cast<char *>(body.data()), body.size());
+                    return file ? body : std::vector<uint8_t>();
+                }
+
+                offset += boxSize;
+                file.seekg(offset);
+            }
+            return {};
+        }
+
+        struct Track
+        {
+            uint32_t timescale = 0;
+            std::vector<int64_t> pts;
+            std::vector<uint64_t> offsets;
+            std::vector<uint32_t> syncSamples;  // 1-based, empty when every sample is a keyframe
+            int64_t duration = 0;
+        };
+
+        static std::optional<Track> readVideoTrack(const std::vector<uint8_t> &movie)
+        {
+            for (const Box &trak : children(movie.data(), movie.size()))
+            {
+                if (trak.type != "trak")
+                    continue;
+
+                auto handler = findPath(trak, { "mdia", "hdlr" });
+                if (!handler || handler->size < 12 || std::memcmp(handler->body + 8, "vide", 4) != 0)
+                    continue;
+
+                auto mediaHeader = findPath(trak, { "mdia", "mdhd" });
+                auto sampleTable = findPath(trak, { "mdia", "minf", "stbl" });
+                if (!mediaHeader || !sampleTable || mediaHeader->size < 24)
+                    return std::nullopt;
+
+                Track track;
+                track.timescale = readU32(mediaHeader->body + (mediaHeader->body[0] == 1 ? 20 : 12));
+
+                const std::vector<Box> tables = children(sampleTable->body, sampleTable->size);
+                auto stts = find(tables, "stts"), ctts = find(tables, "ctts");
+                auto stsc = find(tables, "stsc"), stsz = find(tables, "stsz");
+                auto stco = find(tables, "stco"), co64 = find(tables, "co64");
+                auto stss = find(tables, "stss");
+                if (!stts || !stsc || !stsz || stsz->size < 12 || (!stco && !co64))
+                    return std::nullopt;
+
+                // Decoding timestamps
+                for (const uint8_t *entry : tableEntries(*stts, 8))
+                    for (uint32_t i = 0; i < readU32(entry); ++i)
+                    {
+                        track.pts.push_back(track.duration);
+                        track.duration += readU32(entry + 4);
+                    }
+
+                // Composition offsets turn decoding timestamps into presentation ones
+                if (ctts)
+                {
+                    size_t sample = 0;
+                    for (const uint8_t *entry : tableEntries(*ctts, 8))
+                        for (uint32_t i = 0; i < readU32(entry) && sample < track.pts.size(); ++i)
+                            track.pts[sample++] += static_cast<int32_t>(readU32(entry + 4));
+                }
+
+                // Sample sizes
+                const uint32_t uniformSize = readU32(stsz->body + 4);
+                const size_t sampleCount = std::min<size_t>(readU32(stsz->body + 8), track.pts.size());
+                std::vector<uint32_t> sizes(sampleCount, uniformSize);
+                if (uniformSize == 0)
+                {
+                    const size_t tableSize = std::min<size_t>(sampleCount, (stsz->size - 12) / 4);
+                    for (size_t i = 0; i < tableSize; ++i)
+                        sizes[i] = readU32(stsz->body + 12 + 4 * i);
+                }
+                track.pts.resize(sampleCount);
+
+                // Chunk offsets and sample to chunk mapping give byte offset of every sample
+                std::vector<uint64_t> chunkOffsets;
+                if (co64)
+                    for (const uint8_t *entry : tableEntries(*co64, 8))
+                        chunkOffsets.push_back(readU64(entry));
+                else
+                    for (const uint8_t *entry : tableEntries(*stco, 4))
+                        chunkOffsets.push_back(readU32(entry));
+
+                const std::vector<const uint8_t *> chunkRuns = tableEntries(*stsc, 12);
+                size_t sample = 0;
+                for (size_t run = 0; run < chunkRuns.size() && sample < sampleCount; ++run)
+                {
+                    const uint32_t firstChunk = readU32(chunkRuns[run]);
+                    const uint32_t lastChunk = run + 1 < chunkRuns.size() ?
+                        readU32(chunkRuns[run + 1]) : static_cast<uint32_t>(chunkOffsets.size() + 1);
+                    const uint32_t samplesPerChunk = readU32(chunkRuns[run] + 4);
+
+                    for (uint32_t chunk = firstChunk; chunk < lastChunk && chunk <= chunkOffsets.size(); ++chunk)
+                    {
+                        uint64_t offset = chunkOffsets[chunk - 1];
+                        for (uint32_t i = 0; i < samplesPerChunk && sample < sampleCount; ++i)
+                        {
+                            track.offsets.push_back(offset);
+                            offset += sizes[sample++];
+                        }
+                    }
+                }
+                track.offsets.resize(sampleCount, 0);
+
+                if (stss)
+                    for (const uint8_t *entry : tableEntries(*stss, 4))
+                        track.syncSamples.push_back(readU32(entry));
+
+                return track;
+            }
+            return std::nullopt;
+        }
+    } // namespace mp4
+
+    static void writeIndex(const std::string &indexPath, IndexHeader header,
+                           const std::vector<IndexEntry> &entries)
+    {
+        std::memcpy(header.magic, "FBKI", 4);
+        header.version = KeyframeIndex::VERSION;
+        header.entryCount = entries.size();
+
+        // Write to temporary file first, so readers never map half-written index
+        const std::string temporaryPath = indexPath + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(entries.data()),
+                       entries.size() * sizeof(IndexEntry));
+            if (!file)
+                throw std::filesystem::filesystem_error(
+                    "Cannot write keyframe index " + indexPath,
+                    std::make_error_code(std::errc::io_error));
+        }
+        std::filesystem::rename(temporaryPath, indexPath);
+    }
+
+    void KeyframeIndex::build(const std::string &videoPath, const std::string &indexPath)
+    {
+        if (!std::filesystem::exists(videoPath))
+            throw std::filesystem::filesystem_error(
+                "Cannot open video file " + videoPath,
+                std::make_error_code(std::errc::no_such_file_or_directory));
+
+        IndexHeader header = {};
+        header.videoSize = std::filesystem::file_size(videoPath);
+        std::vector<IndexEntry> entries;
+
+        if (auto track = mp4::readVideoTrack(mp4::readMovieBox(videoPath)); track && !track->pts.empty())
+        {
+            // Presentation order frame number is the rank of sample timestamp
+            std::vector<int64_t> sortedPts = track->pts;
+            std::sort(sortedPts.begin(), sortedPts.end());
+            auto frameOf = [&sortedPts](int64_t pts) -> uint64_t {
+                return std::lower_bound(sortedPts.begin(), sortedPts.end(), pts) - sortedPts.begin();
+            };
+
+            auto addSample = [&](size_t sample) {
+                entries.push_back({ frameOf(track->pts[sample]), track->pts[sample] - sortedPts.front(),
+                                    track->offsets[sample] });
+            };
+
+            if (track->syncSamples.empty())
+                for (size_t sample = 0; sample < track->pts.size(); ++sample)
+                    addSample(sample);
+            else
+                for (uint32_t sample : track->syncSamples)
+                    if (sample >= 1 && sample <= track->pts.size())
+                        addSample(sample - 1);
+
+            header.flags = EXACT_KEYFRAMES;
+            header.timescale = track->timescale;
+            header.frameCount = track->pts.size();
+            header.fps = track->duration > 0 ?
+                double(track->pts.size()) * track->timescale / track->duration : 0.0;
+        }
+        else
+        {
+            // Unknown container, store one seek point per second as reported by OpenCV
+            cv::VideoCapture capture(videoPath);
+            header.timescale = 1000;
+            header.frameCount = static_cast<uint64_t>(std::max(capture.get(cv::CAP_PROP_FRAME_COUNT), 0.0));
+            header.fps = capture.get(cv::CAP_PROP_FPS);
+
+            const uint64_t step = std::max<uint64_t>(static_cast<uint64_t>(std::lround(header.fps)), 1);
+            for (uint64_t frame = 0; frame < header.frameCount; frame += step)
+                entries.push_back({ frame, header.fps > 0 ? std::llround(frame * 1000 / header.fps) : 0, 0 });
+        }
+
+        std::sort(entries.begin(), entries.end(),
+                  [](const IndexEntry &a, const IndexEntry &b) { return a.frame < b.frame; });
+        writeIndex(indexPath, header, entries);
+    }
+
+    KeyframeIndex::KeyframeIndex(const std::string &indexPath)
+        : file(new util::MappedFile(indexPath))
+    {
+        header = reinterpret_cast<const IndexHeader *>(file->getData());
+        entries = reinterpret_cast<const IndexEntry *>(file->getData() + sizeof(IndexHeader));
+
+        if (file->getSize() < sizeof(IndexHeader) || std::memcmp(header->magic, "FBKI", 4) != 0)
+            throw std::runtime_error("Not a keyframe index: " + indexPath);
+        if (header->version != VERSION)
+            throw std::runtime_error("Unsupported keyframe index version " +
+                                     std::to_string(header->version) + " in " + indexPath);
+        // Compared by division, a corrupted count could overflow the expected size back to the real one
+        const size_t entriesSize = file->getSize() - sizeof(IndexHeader);
+        if (entriesSize % sizeof(IndexEntry) != 0 || entriesSize / sizeof(IndexEntry) != header->entryCount)
+            throw std::runtime_error("Truncated keyframe index: " + indexPath);
+    }
+
+    bool KeyframeIndex::matches(const std::string &videoPath) const
+    {
+        std::error_code error;
+        return std::filesystem::file_size(videoPath, error) == header->videoSize && !error;
+    }
+
+    int KeyframeIndex::keyframeAtOrBefore(int frame) const
+    {
+        const IndexEntry *end = entries + size();
+        const IndexEntry *next = std::upper_bound(entries, end, static_cast<uint64_t>(std::max(frame, 0)),
+            [](uint64_t value, const IndexEntry &entry) { return value < entry.frame; });
+        return next == entries ? 0 : static_cast<int>((next - 1)->frame);
+    }
+
+    std::vector<Segment> KeyframeIndex::split(int parts) const
+    {
+        std::vector<int> boundaries = { 0 };
+        for (int i = 1; i < parts; ++i)
+        {
+            const int keyframe = keyframeAtOrBefore(static_cast<int>(int64_t(getFrameCount()) * i / parts));
+            if (keyframe > boundaries.back())
+                boundaries.push_back(keyframe);
+        }
+        boundaries.push_back(getFrameCount());
+
+        std::vector<Segment> ranges;
+        for (size_t i = 0; i + 1 < boundaries.size(); ++i)
+            if (boundaries[i] < boundaries[i + 1])
+                ranges.push_back({ boundaries[i], boundaries[i + 1] });
+        return ranges;
+    }
+} // namespace video
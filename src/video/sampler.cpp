@@ -0,0 +1,38 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "video/sampler.hpp"
+
+namespace video
+{
+    SamplingPolicy parseSamplingPolicy(const std::string &name)
+    {
+        if (name == "fixed")
+            return SamplingPolicy::FIXED;
+        if (name == "adaptive")
+            return SamplingPolicy::ADAPTIVE;
+        throw std::invalid_argument("Unknown sampling policy: " + name);
+    }
+
+    int FrameSampler::framesToSkip(const detection::FoundBallsState &ballsState, double fps) const
+    {
+        if (policy == SamplingPolicy::FIXED)
+            return fixedSkip;
+
+        if (!ballsState.getFoundball())
+            return maxSkip;
+
+        // Kalman state is (x, y, vx, vy, w, h), velocity is expressed in pixels per second
+        const cv::Mat &state = ballsState.kalmanFilter.statePost;
+        const cv::Mat &covariance = ballsState.kalmanFilter.errorCovPost;
+        const double speed = std::hypot(state.at<float>(2), state.at<float>(3)) / fps;
+        const double uncertainty = std::sqrt(covariance.at<float>(0, 0) + covariance.at<float>(1, 1));
+
+        // Shrink the step when the filter is not sure where the ball is
+        double step = targetDisplacement / std::max(speed, 1e-3);
+        step *= targetDisplacement / (targetDisplacement + uncertainty);
+
+        return std::clamp(static_cast<int>(step), minSkip, maxSkip);
+    }
+} // namespace video
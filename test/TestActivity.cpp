@@ -0,0 +1,55 @@
+#include <filesystem>
+
+#include "catch.hpp"
+#include "video/activity.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE( "Activity detector needs a baseline before reporting motion", "[video ActivityDetector]" ) {
+    video::ActivityDetector detector(cv::Size(16, 8), 0.05);
+    const cv::Mat still(64, 128, CV_8UC3, cv::Scalar(40, 40, 40));
+    const cv::Mat moved(64, 128, CV_8UC3, cv::Scalar(220, 220, 220));
+
+    REQUIRE_FALSE(detector.isActive(still, cv::Rect()));
+    REQUIRE_FALSE(detector.isActive(still, cv::Rect()));
+    REQUIRE(detector.isActive(moved, cv::Rect()));
+
+    detector.reset();
+    REQUIRE_FALSE(detector.isActive(moved, cv::Rect()));
+}
+
+TEST_CASE( "Fast-forward skips a run of identical frames", "[video ActivityMonitor]" ) {
+    const fs::path path = fs::temp_directory_path() / "TestActivity.avi";
+    {
+        cv::VideoWriter writer(path.string(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 24, cv::Size(128, 64));
+        REQUIRE(writer.isOpened());
+        for (int i = 0; i < 40; ++i)
+            writer.write(cv::Mat(64, 128, CV_8UC3, cv::Scalar(40, 40, 40)));
+        for (int i = 0; i < 20; ++i)
+            writer.write(cv::Mat(64, 128, CV_8UC3, cv::Scalar(220, 220, 220)));
+    }
+
+    video::FrameSource source(path.string());
+    REQUIRE(source.isOpened());
+    video::ActivityMonitor monitor(5, 10, 0.05);
+
+    // Probes at frames 9, 19, 29 and 39 are still, the one at 49 is not
+    REQUIRE(monitor.fastForward(source, cv::Rect()));
+    REQUIRE(source.getPosition() == 40);
+}
+
+TEST_CASE( "Fast-forward reports the end of a still stream", "[video ActivityMonitor]" ) {
+    const fs::path path = fs::temp_directory_path() / "TestActivityStill.avi";
+    {
+        cv::VideoWriter writer(path.string(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 24, cv::Size(128, 64));
+        REQUIRE(writer.isOpened());
+        for (int i = 0; i < 40; ++i)
+            writer.write(cv::Mat(64, 128, CV_8UC3, cv::Scalar(40, 40, 40)));
+    }
+
+    video::FrameSource source(path.string());
+    video::ActivityMonitor monitor(5, 10, 0.05);
+
+    REQUIRE_FALSE(monitor.fastForward(source, cv::Rect()));
+    REQUIRE(source.getPosition() >= 30);
+}
@@ -0,0 +1,37 @@
+#include "catch.hpp"
+#include "pipeline/analysis.hpp"
+
+using EventType = detection::ScoreCounter::LastEventType;
+
+TEST_CASE( "Range is followed until an event straddling its end is confirmed", "[pipeline analyzeRange]" ) {
+    // 240 fps recording sampled every 31 frames, counter confirms after 24 processed frames without ball
+    const video::Segment range = { 0, 1000 };
+    detection::ScoreCounter scoreCounter(cv::Point(600, 300), 24);
+
+    int position = 0;
+    for (; !pipeline::isRangeFinished(range, position, scoreCounter); position += 31)
+    {
+        // Ball is played until it goes into the left goal shortly before the end of the range
+        if (position < 990)
+            scoreCounter.trackBallAndScore(cv::Point(300, 150), true, position);
+        else
+            scoreCounter.trackBallAndScore(cv::Point(30, 200), false, position);
+    }
+
+    REQUIRE(scoreCounter.getEvents().size() == 1);
+    const detection::ScoreCounter::Event &event = scoreCounter.getEvents()[0];
+    REQUIRE(event.type == EventType::EV_GOOL_RIGHT);
+    REQUIRE(event.detectedAt < range.end);
+    // Confirmation comes later than 2 s of warm-up would allow
+    REQUIRE(event.confirmedAt > range.end + 2 * 240);
+    REQUIRE(position > event.confirmedAt);
+}
+
+TEST_CASE( "Range without pending event finishes at its end", "[pipeline analyzeRange]" ) {
+    const video::Segment range = { 100, 200 };
+    detection::ScoreCounter scoreCounter(cv::Point(600, 300), 24);
+    scoreCounter.trackBallAndScore(cv::Point(300, 150), true, 150);
+
+    REQUIRE_FALSE(pipeline::isRangeFinished(range, 199, scoreCounter));
+    REQUIRE(pipeline::isRangeFinished(range, 200, scoreCounter));
+}
@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "aruco/aruco.hpp"
+#include "aruco/tableDecoder.hpp"
 
 // Nice, no double test macro in this lib?
 #define REQUIRE_DOUBLE(a, b) REQUIRE(std::abs(a - b) <= 10e-8)
@@ -15,3 +16,78 @@ TEST_CASE( "Load configuration from default", "[aruco Configuration]" ) {
     REQUIRE_DOUBLE(p->minMarkerPerimeterRate, d->minMarkerPerimeterRate); // In file, but not changed
     REQUIRE_DOUBLE(p->polygonalApproxAccuracyRate, 2); // Changed value
 }
+
+TEST_CASE( "Marker keeps its corners and middle", "[aruco ArucoMarker]" ) {
+    const std::vector<cv::Point2f> corners = { {0, 0}, {4, 0}, {4, 2}, {0, 2} };
+    const aruco::ArucoMarker marker(3, corners);
+
+    REQUIRE(marker.getId() == 3);
+    REQUIRE(marker.isValid());
+    REQUIRE(marker.getCorners()[2] == cv::Point2f(4, 2));
+    REQUIRE(marker.getMiddle() == cv::Point2f(2, 1));
+
+    const aruco::ArucoMarker copy = marker;
+    REQUIRE(copy.getMiddle() == marker.getMiddle());
+    REQUIRE_FALSE(aruco::ArucoMarker(aruco::ArucoMarker::INVALID_ID, corners).isValid());
+}
+
+TEST_CASE( "Rotation moves top left bit to top right", "[aruco TableMarkerDecoder]" ) {
+    const uint64_t topLeft = 1;
+    REQUIRE(aruco::TableMarkerDecoder::rotateClockwise(topLeft, 5) == (uint64_t(1) << 4));
+
+    const uint64_t code = 0x1A2B3C4;
+    uint64_t rotated = code;
+    for (int i = 0; i < 4; ++i)
+        rotated = aruco::TableMarkerDecoder::rotateClockwise(rotated, 5);
+    REQUIRE(rotated == code);
+}
+
+TEST_CASE( "Table decoder finds marker and its top left corner", "[aruco TableMarkerDecoder]" ) {
+    cv::Ptr<cv::aruco::Dictionary> dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_4X4_50);
+    const aruco::TableMarkerDecoder decoder(dictionary, aruco::TABLE_MARKER_IDS,
+                                            cv::aruco::DetectorParameters::create());
+
+    cv::Mat marker, frame(400, 400, CV_8UC1, cv::Scalar(255));
+    cv::aruco::drawMarker(dictionary, 2, 200, marker);
+    marker.copyTo(frame(cv::Rect(100, 100, 200, 200)));
+
+    aruco::DetectionBuffers buffers;
+    std::vector<aruco::ArucoMarker> found;
+    decoder.detect(frame, found, buffers);
+    REQUIRE(found.size() == 1);
+    REQUIRE(found[0].getId() == 2);
+    REQUIRE(cv::norm(found[0].getCorners()[0] - cv::Point2f(100, 100)) < 3);
+
+    // Top left corner of marker turned clockwise is at top right
+    cv::rotate(frame, frame, cv::ROTATE_90_CLOCKWISE);
+    decoder.detect(frame, found, buffers);
+    REQUIRE(found.size() == 1);
+    REQUIRE(found[0].getId() == 2);
+    REQUIRE(cv::norm(found[0].getCorners()[0] - cv::Point2f(299, 100)) < 3);
+}
+
+TEST_CASE( "Table decoder accepts bit errors like cv::aruco", "[aruco TableMarkerDecoder]" ) {
+    // One cell of 4x4 marker with border is a sixth of its side, flip the top left data cell
+    cv::Ptr<cv::aruco::Dictionary> dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_4X4_50);
+    cv::Mat marker, frame(400, 400, CV_8UC1, cv::Scalar(255));
+    cv::aruco::drawMarker(dictionary, 2, 240, marker);
+    cv::Mat cell = marker(cv::Rect(40, 40, 40, 40));
+    cv::bitwise_not(cell, cell);
+    marker.copyTo(frame(cv::Rect(80, 80, 240, 240)));
+
+    aruco::DetectionBuffers buffers;
+    std::vector<aruco::ArucoMarker> found;
+    cv::Ptr<cv::aruco::DetectorParameters> parameters = cv::aruco::DetectorParameters::create();
+
+    // DICT_4X4_50 corrects one bit, scaled by default rate 0.6 that is none
+    const aruco::TableMarkerDecoder strict(dictionary, aruco::TABLE_MARKER_IDS, parameters);
+    strict.detect(frame, found, buffers);
+    REQUIRE(found.empty());
+
+    parameters = cv::aruco::DetectorParameters::create();
+    parameters->errorCorrectionRate = 1.0;
+    const aruco::TableMarkerDecoder tolerant(dictionary, aruco::TABLE_MARKER_IDS, parameters);
+    tolerant.detect(frame, found, buffers);
+    REQUIRE(found.size() == 1);
+    REQUIRE(found[0].getId() == 2);
+}
@@ -0,0 +1,34 @@
+#include <filesystem>
+#include <fstream>
+
+#include "catch.hpp"
+#include "calib/calibrationCache.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE( "Calibration cache keeps parameters and maps", "[calibration CalibrationCache]" ) {
+    const fs::path path = fs::temp_directory_path() / "TestCalibrationCache.cache";
+    const cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << 800, 0, 320, 0, 810, 240, 0, 0, 1);
+    const cv::Mat distCoeffs = (cv::Mat_<double>(5, 1) << -0.2, 0.1, 0.001, 0.002, -0.05);
+    cv::Mat map1(4, 6, CV_16SC2, cv::Scalar(7, -3)), map2(4, 6, CV_16UC1, cv::Scalar(1023));
+
+    calibration::CalibrationCache::write(path.string(), 42, cameraMatrix, distCoeffs, map1, map2);
+    const calibration::CalibrationCache cache(path.string());
+
+    REQUIRE(cache.getSourceHash() == 42);
+    REQUIRE(cv::norm(cache.getCameraMatrix(), cameraMatrix) == 0);
+    REQUIRE(cv::norm(cache.getDistCoeffs(), distCoeffs) == 0);
+    REQUIRE(cache.hasMaps());
+    REQUIRE(cache.getMapSize() == cv::Size(6, 4));
+    REQUIRE(cv::norm(cache.getMap1(), map1, cv::NORM_INF) == 0);
+    REQUIRE(cv::norm(cache.getMap2(), map2, cv::NORM_INF) == 0);
+}
+
+TEST_CASE( "Calibration hash follows file content", "[calibration CalibrationCache]" ) {
+    const fs::path path = fs::temp_directory_path() / "TestCalibrationCache.xml";
+    std::ofstream(path) << "<camera_matrix>1</camera_matrix>";
+    const uint64_t first = calibration::CalibrationCache::hashFile(path.string());
+    std::ofstream(path) << "<camera_matrix>2</camera_matrix>";
+
+    REQUIRE(calibration::CalibrationCache::hashFile(path.string()) != first);
+}
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "calib/cameraCalibration.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << 800, 0, 320, 0, 800, 240, 0, 0, 1);
+
+    std::string writeCalibration(const cv::Mat &distCoeffs)
+    {
+        const fs::path path = fs::temp_directory_path() / "TestCameraCalibration.xml";
+        fs::remove(path.string() + ".cache");
+        cv::FileStorage file(path.string(), cv::FileStorage::WRITE);
+        file << "camera_matrix" << cameraMatrix;
+        file << "distortion_coefficients" << distCoeffs;
+        file << "fisheye_model" << false;
+        return path.string();
+    }
+
+    const cv::Size viewSize(1280, 720);
+    const cv::Mat viewCamera = (cv::Mat_<double>(3, 3) << 800, 0, 640, 0, 800, 360, 0, 0, 1);
+
+    // Chessboard with 9x6 inner corners and unit squares, other settings off
+    Settings boardSettings()
+    {
+        Settings s;
+        s.boardSize = cv::Size(9, 6);
+        s.squareSize = 1;
+        s.calibrationPattern = Settings::CHESSBOARD;
+        s.aspectRatio = 0;
+        s.calibZeroTangentDist = false;
+        s.calibFixPrincipalPoint = false;
+        s.useFisheye = false;
+        s.searchWidth = 0;
+        s.maxViews = 0;
+        s.outlierRatio = 0;
+        s.flag = 0;
+        s.outputFileName = (fs::temp_directory_path() / "TestCameraCalibration.xml").string();
+        return s;
+    }
+
+    // Corners of the board rotated around its center, which is moved to given point in front of the camera.
+    // Jitter is a fixed pattern, so views do not depend on a random generator.
+    std::vector<cv::Point2f> viewOfBoard(cv::Vec3d rotation, cv::Vec3d center, const cv::Mat &distCoeffs,
+                                         float jitter = 0, int seed = 0)
+    {
+        std::vector<cv::Point3f> board;
+        for (int i = 0; i < 6; ++i)
+            for (int j = 0; j < 9; ++j)
+                board.push_back(cv::Point3f((float)j, (float)i, 0));
+
+        cv::Matx33d rotationMatrix;
+        cv::Rodrigues(rotation, rotationMatrix);
+        const cv::Vec3d translation = center - rotationMatrix * cv::Vec3d(4, 2.5, 0);
+
+        std::vector<cv::Point2f> points;
+        cv::projectPoints(board, rotation, translation, viewCamera, distCoeffs, points);
+        for (int i = 0; i < (int)points.size(); ++i)
+            points[i] += cv::Point2f(jitter * ((i + seed) % 3 - 1), jitter * ((i * 7 + seed) % 3 - 1));
+        return points;
+    }
+
+    // Poses seen from different positions and tilts, all inside the view
+    const std::vector<std::pair<cv::Vec3d, cv::Vec3d> > poses = {
+        { { 0, 0, 0 }, { 0, 0, 12 } },
+        { { 0.3, 0, 0 }, { -4, -2, 14 } },
+        { { -0.3, 0, 0 }, { 4, 2, 14 } },
+        { { 0, 0.4, 0 }, { -4, 2, 13 } },
+        { { 0, -0.4, 0 }, { 4, -2, 13 } },
+        { { 0.2, 0.2, 0.3 }, { 0, 0, 20 } },
+        { { 0.4, -0.2, 0 }, { 0, 2, 15 } },
+        { { -0.4, 0.2, 0 }, { 0, -2, 15 } },
+        { { 0.1, 0.3, -0.3 }, { -3, 0, 16 } },
+        { { -0.2, -0.3, 0.2 }, { 3, 0, 16 } },
+    };
+}
+
+TEST_CASE( "Distorted points are undistorted back to where they were", "[calibration CameraCalibration]" ) {
+    const cv::Mat distCoeffs = (cv::Mat_<double>(5, 1) << 0.1, 0, 0, 0, 0);
+    const calibration::CameraCalibration calibration("", writeCalibration(distCoeffs));
+
+    const std::vector<cv::Point2f> undistorted = { { 320, 240 }, { 600, 400 } };
+    std::vector<cv::Point2f> distorted, back;
+    REQUIRE(calibration.distortPoints(undistorted, distorted, 0));
+    REQUIRE(distorted.size() == 2);
+
+    // Principal point stays, positive k1 pushes other points away from it
+    REQUIRE(cv::norm(distorted[0] - undistorted[0]) < 1e-3);
+    REQUIRE(cv::norm(distorted[1] - undistorted[0]) > cv::norm(undistorted[1] - undistorted[0]));
+
+    cv::undistortPoints(distorted, back, cameraMatrix, distCoeffs, cv::noArray(), cameraMatrix);
+    REQUIRE(cv::norm(back[1] - undistorted[1]) < 0.05);
+}
+
+TEST_CASE( "Points of a frame undistorted before a swap are not distorted", "[calibration CameraCalibration]" ) {
+    const cv::Mat distCoeffs = (cv::Mat_<double>(5, 1) << 0.1, 0, 0, 0, 0);
+    calibration::CameraCalibration calibration("", writeCalibration(distCoeffs));
+
+    cv::Mat frame(48, 64, CV_8UC3, cv::Scalar(0, 0, 0)), undistortedFrame;
+    const uint64_t before = calibration.undistort(frame, undistortedFrame);
+
+    calibration.setParameters(cameraMatrix, (cv::Mat_<double>(5, 1) << 0.2, 0, 0, 0, 0));
+    const uint64_t after = calibration.undistort(frame, undistortedFrame);
+    REQUIRE(after != before);
+
+    std::vector<cv::Point2f> distorted;
+    REQUIRE_FALSE(calibration.distortPoints({ { 600, 400 } }, distorted, before));
+    REQUIRE(calibration.distortPoints({ { 600, 400 } }, distorted, after));
+}
+
+TEST_CASE( "Selected views keep distinct poses and drop repeated ones", "[calibration CameraCalibration]" ) {
+    Settings s = boardSettings();
+    s.maxViews = 6;
+
+    // Six distinct poses, the first one also seen three times before and after them
+    std::vector<std::vector<cv::Point2f> > views;
+    for (int seed = 0; seed < 3; ++seed)
+        views.push_back(viewOfBoard(poses[0].first, poses[0].second, cv::Mat(), 0.2f, seed));
+    for (size_t i = 0; i < 6; ++i)
+        views.push_back(viewOfBoard(poses[i].first, poses[i].second, cv::Mat()));
+    for (int seed = 3; seed < 6; ++seed)
+        views.push_back(viewOfBoard(poses[0].first, poses[0].second, cv::Mat(), 0.2f, seed));
+    const std::vector<std::vector<cv::Point2f> > all = views;
+
+    calibration::CameraCalibration::selectViews(s, viewSize, views);
+    REQUIRE(views.size() == 6);
+
+    for (size_t i = 1; i < 6; ++i)
+        REQUIRE(std::find(views.begin(), views.end(), all[3 + i]) != views.end());
+    const auto repeated = std::count_if(views.begin(), views.end(), [&all](const std::vector<cv::Point2f> &view) {
+        return cv::norm(view[0] - all[3][0]) < 1;
+    });
+    REQUIRE(repeated == 1);
+}
+
+TEST_CASE( "View with misplaced points is rejected", "[calibration CameraCalibration]" ) {
+    Settings s = boardSettings();
+    s.flag = cv::CALIB_ZERO_TANGENT_DIST | cv::CALIB_FIX_K3;
+    s.outlierRatio = 3;
+
+    const cv::Mat distCoeffs = (cv::Mat_<double>(5, 1) << -0.2, 0.05, 0, 0, 0);
+    std::vector<std::vector<cv::Point2f> > views;
+    for (size_t i = 0; i < poses.size(); ++i)
+        views.push_back(viewOfBoard(poses[i].first, poses[i].second, distCoeffs, 0.1f, (int)i));
+
+    // Every other point of one view is three pixels off, as if corners were mixed up
+    std::vector<cv::Point2f> bad = viewOfBoard({ 0.1, 0.1, 0 }, { 1, 1, 14 }, distCoeffs);
+    for (size_t i = 0; i < bad.size(); i += 2)
+        bad[i] += cv::Point2f(3, -3);
+    views.insert(views.begin() + 4, bad);
+
+    calibration::CameraCalibration::rejectOutlierViews(s, viewSize, views);
+    REQUIRE(views.size() == poses.size());
+    REQUIRE(std::find(views.begin(), views.end(), bad) == views.end());
+}
+
+TEST_CASE( "Chessboard found on downscaled view is refined on full resolution", "[calibration CameraCalibration]" ) {
+    // 10x7 squares with a margin of one square, seen at an angle
+    const int square = 60;
+    cv::Mat board(9 * square, 12 * square, CV_8UC1, cv::Scalar(255));
+    for (int i = 0; i < 7; ++i)
+        for (int j = 0; j < 10; ++j)
+            if ((i + j) % 2 == 0)
+                board(cv::Rect((j + 1) * square, (i + 1) * square, square, square)).setTo(cv::Scalar(0));
+
+    const cv::Matx33d homography(1.5, 0.1, 150, 0.05, 1.45, 120, 0.0001, 0.00005, 1);
+    cv::Mat warped, view;
+    cv::warpPerspective(board, warped, homography, cv::Size(1600, 1200), cv::INTER_LINEAR, cv::BORDER_CONSTANT,
+                        cv::Scalar(255));
+    cv::cvtColor(warped, view, cv::COLOR_GRAY2BGR);
+
+    std::vector<cv::Point2f> corners, truth;
+    for (int i = 0; i < 6; ++i)
+        for (int j = 0; j < 9; ++j)
+            corners.push_back(cv::Point2f((j + 2) * square - 0.5f, (i + 2) * square - 0.5f));
+    cv::perspectiveTransform(corners, truth, homography);
+
+    Settings s = boardSettings();
+    for (int searchWidth : { 0, 800, 400 })
+    {
+        s.searchWidth = searchWidth;
+        std::vector<cv::Point2f> points;
+        REQUIRE(calibration::CameraCalibration::findPattern(s, view, points));
+        REQUIRE(points.size() == truth.size());
+        for (size_t i = 0; i < points.size(); ++i)
+            REQUIRE(cv::norm(points[i] - truth[i]) < 0.25);
+    }
+}
+
+TEST_CASE( "Circles found on downscaled view are found again on full resolution", "[calibration CameraCalibration]" ) {
+    // 7x5 circles with a margin of one spacing, drawn larger so their edges are smooth once shrunk
+    const int spacing = 60, supersampling = 8;
+    cv::Mat large(7 * spacing * supersampling, 9 * spacing * supersampling, CV_8UC1, cv::Scalar(255));
+    std::vector<cv::Point2f> truth;
+    for (int i = 0; i < 5; ++i)
+        for (int j = 0; j < 7; ++j)
+        {
+            const cv::Point center(spacing * 3 / 2 + j * spacing, spacing * 3 / 2 + i * spacing);
+            cv::circle(large, center * supersampling, 18 * supersampling, cv::Scalar(0), -1);
+            // Center of the drawn pixel, scaled and moved like the pattern below
+            const float offset = 0.5f / supersampling - 0.5f;
+            truth.push_back(cv::Point2f((center.x + offset) * 1.5f + 150, (center.y + offset) * 1.5f + 120));
+        }
+
+    cv::Mat pattern, warped, view;
+    cv::resize(large, pattern, cv::Size(), 1.0 / supersampling, 1.0 / supersampling, cv::INTER_AREA);
+    const cv::Matx33d transform(1.5, 0, 150, 0, 1.5, 120, 0, 0, 1);
+    cv::warpPerspective(pattern, warped, transform, cv::Size(1600, 1200), cv::INTER_LINEAR, cv::BORDER_CONSTANT,
+                        cv::Scalar(255));
+    cv::cvtColor(warped, view, cv::COLOR_GRAY2BGR);
+
+    Settings s = boardSettings();
+    s.boardSize = cv::Size(7, 5);
+    s.calibrationPattern = Settings::CIRCLES_GRID;
+    for (int searchWidth : { 0, 800, 400 })
+    {
+        s.searchWidth = searchWidth;
+        std::vector<cv::Point2f> points;
+        REQUIRE(calibration::CameraCalibration::findPattern(s, view, points));
+        REQUIRE(points.size() == truth.size());
+        for (size_t i = 0; i < points.size(); ++i)
+            REQUIRE(cv::norm(points[i] - truth[i]) < 0.25);
+    }
+}
+
+TEST_CASE( "Model matching the lens has the lowest held-out error", "[calibration CameraCalibration]" ) {
+    Settings s = boardSettings();
+    s.calibZeroTangentDist = true;
+
+    // Thin prism shifts points sideways, which only the 12 coefficient model can describe
+    const cv::Mat distCoeffs = (cv::Mat_<double>(12, 1) << -0.1, 0, 0, 0, 0, 0, 0, 0, 0.02, 0, -0.02, 0);
+    std::vector<std::vector<cv::Point2f> > views;
+    for (size_t i = 0; i < poses.size(); ++i)
+        views.push_back(viewOfBoard(poses[i].first, poses[i].second, distCoeffs, 0.05f, (int)i));
+
+    calibration::CameraCalibration::searchModel(s, viewSize, views);
+    REQUIRE_FALSE(s.useFisheye);
+    REQUIRE(s.flag == (cv::CALIB_ZERO_TANGENT_DIST | cv::CALIB_RATIONAL_MODEL | cv::CALIB_THIN_PRISM_MODEL));
+
+    std::ifstream report(s.outputFileName + ".models.csv");
+    std::string line, chosen;
+    while (std::getline(report, line))
+        if (line.size() > 2 && line.compare(line.size() - 2, 2, ",1") == 0)
+            chosen = line.substr(0, line.find(','));
+    REQUIRE(chosen == "thin-prism-12");
+}
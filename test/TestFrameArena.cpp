@@ -0,0 +1,96 @@
+#include <memory_resource>
+#include <vector>
+
+#include "catch.hpp"
+#include "detection/detection.hpp"
+#include "util/frameArena.hpp"
+
+namespace
+{
+    std::vector<std::vector<cv::Point>> ballCandidates()
+    {
+        // Square ball, too small blob and elongated player-like blob
+        return {
+            {{10, 10}, {30, 10}, {30, 30}, {10, 30}},
+            {{50, 50}, {53, 50}, {53, 53}, {50, 53}},
+            {{100, 10}, {110, 10}, {110, 80}, {100, 80}},
+        };
+    }
+
+    // Installed as default resource only around the measured code, catches containers which bypass the arena
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        long long allocations = 0;
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            allocations++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *pointer, size_t bytes, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+}
+
+TEST_CASE( "Arena stops touching the heap after warm-up", "[util FrameArena]" ) {
+    util::FrameArena arena(64);
+
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        std::pmr::vector<int> values(arena.get());
+        values.resize(1000);
+        values.clear();
+        arena.reset();
+    }
+    const long long warmedUp = arena.getHeapAllocations();
+
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        std::pmr::vector<int> values(arena.get());
+        values.resize(1000);
+        values.clear();
+        arena.reset();
+    }
+
+    REQUIRE( arena.getHeapAllocations() == warmedUp );
+    REQUIRE( arena.getCapacity() >= 1000 * sizeof(int) );
+}
+
+TEST_CASE( "Ball candidates are filtered without heap allocations", "[detection FrameArena]" ) {
+    const std::vector<std::vector<cv::Point>> contours = ballCandidates();
+    util::FrameArena arena;
+
+    {
+        detection::BallDetection ball(arena.get());
+        detection::filterBallCandidates(contours, ball);
+        REQUIRE( ball.boxes.size() == 1 );
+        REQUIRE( ball.boxes[0] == cv::Rect(10, 10, 21, 21) );
+    }
+    arena.reset();
+
+    const long long before = arena.getHeapAllocations();
+    CountingResource counting;
+    std::pmr::memory_resource *previous = std::pmr::set_default_resource(&counting);
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        {
+            detection::BallDetection ball(arena.get());
+            detection::filterBallCandidates(contours, ball);
+        }
+        arena.reset();
+    }
+    std::pmr::set_default_resource(previous);
+
+    REQUIRE( arena.getHeapAllocations() == before );
+    REQUIRE( counting.allocations == 0 );
+}
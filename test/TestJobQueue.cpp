@@ -0,0 +1,173 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "catch.hpp"
+#include "pipeline/jobQueue.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    fs::path emptyJobDirectory(const std::string &name)
+    {
+        const fs::path directory = fs::temp_directory_path() / name;
+        fs::remove_all(directory);
+        return directory;
+    }
+}
+
+TEST_CASE( "Job is claimed by one worker only", "[pipeline JobQueue]" ) {
+    const fs::path directory = emptyJobDirectory("foosball_jobs_claim");
+    pipeline::JobQueue first(directory.string(), "first", std::chrono::hours(1));
+    pipeline::JobQueue second(directory.string(), "second", std::chrono::hours(1));
+
+    first.add({ "game.mp4.000", "game.mp4", { 0, 100 } });
+    first.add({ "game.mp4.001", "game.mp4", { 100, 200 } });
+    second.add({ "game.mp4.000", "game.mp4", { 0, 100 } });
+    REQUIRE(second.getJobs().size() == 2);
+
+    auto firstJob = first.claimNext();
+    auto secondJob = second.claimNext();
+    REQUIRE(firstJob);
+    REQUIRE(secondJob);
+    REQUIRE(firstJob->name == "game.mp4.000");
+    REQUIRE(secondJob->name == "game.mp4.001");
+    REQUIRE(!first.claimNext());
+
+    // Live locks are never broken
+    REQUIRE(second.requeueStale() == 0);
+
+    pipeline::Result result;
+    result.video = "game.mp4";
+    result.range = firstJob->range;
+    first.complete(*firstJob, result);
+    REQUIRE(second.isDone(*firstJob));
+    REQUIRE(!second.isFinished());
+
+    second.fail(*secondJob, "cannot decode");
+    REQUIRE(first.isFailed(*secondJob));
+    REQUIRE(first.isFinished());
+    REQUIRE(!first.claimNext());
+
+    fs::remove_all(directory);
+}
+
+TEST_CASE( "Job of dead worker returns to the queue", "[pipeline JobQueue]" ) {
+    const fs::path directory = emptyJobDirectory("foosball_jobs_requeue");
+    pipeline::JobQueue dead(directory.string(), "dead", std::chrono::milliseconds(50));
+    pipeline::JobQueue alive(directory.string(), "alive", std::chrono::milliseconds(50));
+
+    dead.add({ "game.mp4.000", "game.mp4", { 0, 100 } });
+    REQUIRE(dead.claimNext());
+    REQUIRE(!alive.claimNext());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    REQUIRE(alive.requeueStale() == 1);
+    REQUIRE(alive.claimNext());
+
+    fs::remove_all(directory);
+}
+
+TEST_CASE( "Worker whose lock was broken leaves the new lock alone", "[pipeline JobQueue]" ) {
+    const fs::path directory = emptyJobDirectory("foosball_jobs_broken");
+    pipeline::JobQueue slow(directory.string(), "slow", std::chrono::milliseconds(50));
+    pipeline::JobQueue other(directory.string(), "other", std::chrono::milliseconds(50));
+
+    const pipeline::Job job = { "game.mp4.000", "game.mp4", { 0, 100 } };
+    slow.add(job);
+    REQUIRE(slow.claim(job));
+
+    // Slow worker misses its heartbeats, the job is taken over
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    REQUIRE(other.requeueStale() == 1);
+    REQUIRE(other.claim(job));
+
+    const fs::path lock = directory / "locks" / "game.mp4.000.lock";
+    slow.fail(job, "too slow");
+    REQUIRE(fs::exists(lock));
+    slow.release(job);
+    REQUIRE(fs::exists(lock));
+
+    other.release(job);
+    REQUIRE(!fs::exists(lock));
+
+    fs::remove_all(directory);
+}
+
+#ifndef _WIN32
+TEST_CASE( "Jobs are shared by worker processes without overlap", "[pipeline JobQueue]" ) {
+    const fs::path directory = emptyJobDirectory("foosball_jobs_processes");
+    const fs::path claims = directory / "claims";
+    fs::create_directories(claims);
+
+    const int jobCount = 40, workerCount = 4;
+    {
+        pipeline::JobQueue queue(directory.string(), "enqueue", std::chrono::hours(1));
+        for (int i = 0; i < jobCount; ++i)
+            queue.add({ "game.mp4." + std::to_string(1000 + i), "game.mp4", { i * 100, (i + 1) * 100 } });
+    }
+
+    // Every process records the jobs it claimed, results alone would hide a job done twice
+    std::vector<pid_t> workers;
+    for (int w = 0; w < workerCount; ++w)
+    {
+        const pid_t pid = fork();
+        REQUIRE(pid >= 0);
+        if (pid == 0)
+        {
+            int status = 0;
+            try
+            {
+                const std::string workerId = "worker-" + std::to_string(w);
+                pipeline::JobQueue queue(directory.string(), workerId, std::chrono::hours(1));
+                while (const auto job = queue.claimNext())
+                {
+                    std::ofstream(claims / (job->name + "." + workerId));
+                    queue.requeueStale();
+
+                    pipeline::Result result;
+                    result.video = job->video;
+                    result.range = job->range;
+                    queue.complete(*job, result);
+                }
+            }
+            catch (...)
+            {
+                status = 1;
+            }
+            _exit(status);
+        }
+        workers.push_back(pid);
+    }
+
+    for (const pid_t pid : workers)
+    {
+        int status = 0;
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 0);
+    }
+
+    pipeline::JobQueue queue(directory.string(), "check", std::chrono::hours(1));
+    REQUIRE(queue.isFinished());
+    for (const pipeline::Job &job : queue.getJobs())
+    {
+        int claimed = 0;
+        for (const auto &entry : fs::directory_iterator(claims))
+            claimed += entry.path().stem().string() == job.name;
+        REQUIRE(claimed == 1);
+    }
+    REQUIRE(fs::is_empty(directory / "locks"));
+
+    fs::remove_all(directory);
+}
+#endif
@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "catch.hpp"
+#include "video/keyframeIndex.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    std::string u32(uint32_t value)
+    {
+        return { char(value >> 24), char(value >> 16), char(value >> 8), char(value) };
+    }
+
+    std::string box(const char *type, const std::string &body)
+    {
+        return u32(static_cast<uint32_t>(8 + body.size())) + type + body;
+    }
+
+    // Full box with version and flags zero, entry count and entries given as 32-bit values
+    std::string table(const char *type, std::initializer_list<uint32_t> values, uint32_t count)
+    {
+        std::string body = u32(0) + u32(count);
+        for (uint32_t value : values)
+            body += u32(value);
+        return box(type, body);
+    }
+
+    /*
+     * Six samples of 1/24 s in two chunks of three, keyframes are samples 1 and 4.
+     * Chunks start at bytes 1000 and 2000, first samples of chunks are 100 bytes long.
+     */
+    std::string movie()
+    {
+        const std::string mdhd = box("mdhd", u32(0) + u32(0) + u32(0) + u32(24000) + u32(6000) + u32(0));
+        const std::string hdlr = box("hdlr", u32(0) + u32(0) + "vide" + u32(0) + u32(0) + u32(0) + '\0');
+        const std::string stbl = box("stbl",
+            table("stts", { 6, 1000 }, 1) +
+            table("stsc", { 1, 3, 1 }, 1) +
+            box("stsz", u32(0) + u32(0) + u32(6) + u32(100) + u32(50) + u32(50) + u32(100) + u32(50) + u32(50)) +
+            table("stco", { 1000, 2000 }, 2) +
+            table("stss", { 1, 4 }, 2));
+        const std::string trak = box("trak", box("mdia", mdhd + hdlr + box("minf", stbl)));
+        return box("ftyp", "isom" + u32(0)) + box("mdat", std::string(64, '\0')) + box("moov", trak);
+    }
+}
+
+TEST_CASE( "Keyframes are read from MP4 sample tables", "[video KeyframeIndex]" ) {
+    const fs::path videoPath = fs::temp_directory_path() / "TestKeyframeIndex.mp4";
+    const fs::path indexPath = fs::temp_directory_path() / "TestKeyframeIndex.mp4.fidx";
+    std::ofstream(videoPath, std::ios::binary | std::ios::trunc) << movie();
+
+    video::KeyframeIndex::build(videoPath.string(), indexPath.string());
+    const video::KeyframeIndex index(indexPath.string());
+
+    REQUIRE(index.isExact());
+    REQUIRE(index.matches(videoPath.string()));
+    REQUIRE(index.getFrameCount() == 6);
+    REQUIRE(index.getTimescale() == 24000);
+    REQUIRE(index.getFps() == Approx(24.0));
+    REQUIRE(index.size() == 2);
+    REQUIRE(index[0].frame == 0);
+    REQUIRE(index[0].byteOffset == 1000);
+    REQUIRE(index[1].frame == 3);
+    REQUIRE(index[1].pts == 3000);
+    REQUIRE(index[1].byteOffset == 2000);
+
+    REQUIRE(index.keyframeAtOrBefore(-1) == 0);
+    REQUIRE(index.keyframeAtOrBefore(2) == 0);
+    REQUIRE(index.keyframeAtOrBefore(3) == 3);
+    REQUIRE(index.keyframeAtOrBefore(5) == 3);
+
+    // Ranges start at keyframes, so there are never more of them than keyframes
+    const std::vector<video::Segment> ranges = index.split(4);
+    REQUIRE(ranges.size() == 2);
+    REQUIRE(ranges[0].begin == 0);
+    REQUIRE(ranges[0].end == 3);
+    REQUIRE(ranges[1].begin == 3);
+    REQUIRE(ranges[1].end == 6);
+
+    std::ofstream(videoPath, std::ios::binary | std::ios::app) << '\0';
+    REQUIRE_FALSE(index.matches(videoPath.string()));
+}
+
+TEST_CASE( "Damaged keyframe index is rejected", "[video KeyframeIndex]" ) {
+    const fs::path videoPath = fs::temp_directory_path() / "TestKeyframeIndexDamaged.mp4";
+    const fs::path indexPath = fs::temp_directory_path() / "TestKeyframeIndexDamaged.mp4.fidx";
+    std::ofstream(videoPath, std::ios::binary | std::ios::trunc) << movie();
+    video::KeyframeIndex::build(videoPath.string(), indexPath.string());
+
+    std::string content;
+    {
+        std::ifstream file(indexPath, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    REQUIRE(content.size() == sizeof(video::IndexHeader) + 2 * sizeof(video::IndexEntry));
+
+    // Count whose size in bytes wraps around to the real size of two entries
+    video::IndexHeader header;
+    std::memcpy(&header, content.data(), sizeof(header));
+    header.entryCount = 2 + (uint64_t(1) << 61);
+    std::string damaged = content;
+    std::memcpy(&damaged[0], &header, sizeof(header));
+    std::ofstream(indexPath, std::ios::binary | std::ios::trunc) << damaged;
+    REQUIRE_THROWS_AS(video::KeyframeIndex(indexPath.string()), std::runtime_error);
+
+    std::ofstream(indexPath, std::ios::binary | std::ios::trunc) << content.substr(0, content.size() - 1);
+    REQUIRE_THROWS_AS(video::KeyframeIndex(indexPath.string()), std::runtime_error);
+
+    std::ofstream(indexPath, std::ios::binary | std::ios::trunc) << "FBKX" << content.substr(4);
+    REQUIRE_THROWS_AS(video::KeyframeIndex(indexPath.string()), std::runtime_error);
+}
+
+TEST_CASE( "Other containers get a seek point every second", "[video KeyframeIndex]" ) {
+    const fs::path videoPath = fs::temp_directory_path() / "TestKeyframeIndex.avi";
+    const fs::path indexPath = fs::temp_directory_path() / "TestKeyframeIndex.avi.fidx";
+    {
+        cv::VideoWriter writer(videoPath.string(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10, cv::Size(64, 32));
+        REQUIRE(writer.isOpened());
+        for (int i = 0; i < 50; ++i)
+            writer.write(cv::Mat(32, 64, CV_8UC3, cv::Scalar(i, i, i)));
+    }
+
+    video::KeyframeIndex::build(videoPath.string(), indexPath.string());
+    const video::KeyframeIndex index(indexPath.string());
+
+    REQUIRE_FALSE(index.isExact());
+    REQUIRE(index.getFrameCount() == 50);
+    REQUIRE(index.size() == 5);
+    REQUIRE(index[2].frame == 20);
+    REQUIRE(index[2].pts == 2000);
+    REQUIRE(index.keyframeAtOrBefore(25) == 20);
+}
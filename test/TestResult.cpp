@@ -0,0 +1,46 @@
+#include "catch.hpp"
+#include "pipeline/result.hpp"
+
+using EventType = detection::ScoreCounter::LastEventType;
+
+TEST_CASE( "Merge results of chunks in order", "[pipeline Result]" ) {
+    pipeline::Result first, second;
+    first.video = second.video = "game.mp4";
+    first.range = { 0, 100 };
+    second.range = { 100, 250 };
+    first.trajectory = { { 10, cv::Point(1, 2), true }, { 50, cv::Point(3, 4), false } };
+    second.trajectory = { { 120, cv::Point(5, 6), true } };
+    first.events = { { EventType::EV_GOOL_LEFT, 40, 64 } };
+    second.events = { { EventType::EV_OUT, 130, 154 } };
+
+    pipeline::Result merged = pipeline::mergeResults({ second, first });
+
+    REQUIRE(merged.range.begin == 0);
+    REQUIRE(merged.range.end == 250);
+    REQUIRE(merged.trajectory.size() == 3);
+    REQUIRE(merged.trajectory[0].frame == 10);
+    REQUIRE(merged.trajectory[2].frame == 120);
+    REQUIRE(merged.events.size() == 2);
+    REQUIRE(merged.events[0].type == EventType::EV_GOOL_LEFT);
+    REQUIRE(merged.events[1].detectedAt == 130);
+}
+
+TEST_CASE( "Result survives JSON round trip", "[pipeline Result]" ) {
+    pipeline::Result result;
+    result.video = "game.mp4";
+    result.range = { 5, 15 };
+    result.trajectory = { { 7, cv::Point(100, 200), true } };
+    result.events = { { EventType::EV_GOOL_RIGHT, 8, 12 } };
+
+    nlohmann::json json = pipeline::toJson(result);
+    REQUIRE(json["score"]["right"] == 1);
+    REQUIRE(json["score"]["left"] == 0);
+
+    pipeline::Result restored = pipeline::resultFromJson(json);
+    REQUIRE(restored.video == "game.mp4");
+    REQUIRE(restored.range.end == 15);
+    REQUIRE(restored.trajectory[0].position.y == 200);
+    REQUIRE(restored.trajectory[0].found);
+    REQUIRE(restored.events[0].type == EventType::EV_GOOL_RIGHT);
+    REQUIRE(restored.events[0].confirmedAt == 12);
+}
@@ -0,0 +1,143 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "aruco/aruco.hpp"
+#include "detection/detection.hpp"
+#include "detection/table.hpp"
+
+namespace
+{
+    // Square markers of side 20 inside corners of a 600x300 table seen at offset (100, 50)
+    std::vector<aruco::ArucoMarker> tableMarkers()
+    {
+        const cv::Point2f offset(100, 50);
+        const cv::Point2f tableCorners[4] = { { 600, 0 }, { 600, 300 }, { 0, 300 }, { 0, 0 } };
+
+        std::vector<aruco::ArucoMarker> markers;
+        for (int id = 0; id < 4; ++id)
+        {
+            const cv::Point2f corner = tableCorners[id] + offset;
+            const cv::Point2f next = tableCorners[(id + 1) % 4] - tableCorners[id];
+            const cv::Point2f previous = tableCorners[(id + 3) % 4] - tableCorners[id];
+            const cv::Point2f alongNext = next * (20.0f / static_cast<float>(cv::norm(next)));
+            const cv::Point2f alongPrevious = previous * (20.0f / static_cast<float>(cv::norm(previous)));
+            markers.emplace_back(id, std::array<cv::Point2f, 4>{ corner, corner + alongNext,
+                                                                 corner + alongNext + alongPrevious,
+                                                                 corner + alongPrevious });
+        }
+        return markers;
+    }
+}
+
+TEST_CASE( "Camera region maps table corners to table image corners", "[detection Table]" ) {
+    detection::Table table(600, 300);
+    table.updateTableOnFrame(tableMarkers());
+
+    detection::CameraRegion region;
+    REQUIRE(table.updateCameraRegion(cv::Size(800, 400), region));
+    REQUIRE(region.roi == table.getBoundingRect());
+    REQUIRE(region.masks[detection::Mode::BALL].size() == region.roi.size());
+
+    const cv::Point2f tableCorners[4] = { { 600, 0 }, { 600, 300 }, { 0, 300 }, { 0, 0 } };
+    std::vector<cv::Point2f> inRegion, inTable;
+    for (const cv::Point2f &corner : table.getCorners())
+        inRegion.push_back(corner - cv::Point2f(region.roi.tl()));
+    cv::perspectiveTransform(inRegion, inTable, region.toTable);
+    for (int i = 0; i < 4; ++i)
+        REQUIRE(cv::norm(inTable[i] - tableCorners[i]) < 1e-3);
+
+    // Ball is searched everywhere on the table
+    const cv::Point middle(region.roi.width / 2, region.roi.height / 2);
+    REQUIRE(region.masks[detection::Mode::BALL].at<unsigned char>(middle) == 255);
+}
+
+TEST_CASE( "Contours follow homography", "[detection Table]" ) {
+    std::vector<std::vector<cv::Point>> contours = { { { 0, 0 }, { 10, 0 }, { 10, 10 } } };
+    const cv::Mat scale = (cv::Mat_<double>(3, 3) << 2, 0, 5, 0, 2, 0, 0, 0, 1);
+
+    detection::transformContours(contours, scale);
+    REQUIRE(contours[0][0] == cv::Point(5, 0));
+    REQUIRE(contours[0][2] == cv::Point(25, 20));
+
+    detection::transformContours(contours, cv::Mat());
+    REQUIRE(contours[0][1] == cv::Point(25, 0));
+}
+
+TEST_CASE( "Table is acquired from four markers only", "[detection Table]" ) {
+    detection::Table table(600, 300);
+    std::vector<aruco::ArucoMarker> markers = tableMarkers();
+    markers.pop_back();
+
+    table.updateTableOnFrame(markers);
+    REQUIRE(table.getState() == detection::TableState::SEARCHING);
+    REQUIRE_FALSE(table.hasTable());
+    REQUIRE(table.getBoundingRect().empty());
+
+    table.updateTableOnFrame(tableMarkers());
+    REQUIRE(table.getState() == detection::TableState::ACQUIRED);
+}
+
+TEST_CASE( "Hidden marker is completed from the other three", "[detection Table]" ) {
+    detection::Table table(600, 300);
+    table.updateTableOnFrame(tableMarkers());
+    const std::vector<cv::Point2f> acquired = table.getCorners();
+
+    // Camera moved a bit while marker 2 is covered
+    const cv::Point2f shift(5, 3);
+    std::vector<aruco::ArucoMarker> markers;
+    for (const aruco::ArucoMarker &marker : tableMarkers())
+    {
+        if (marker.getId() == 2)
+            continue;
+        std::array<cv::Point2f, 4> corners = marker.getCorners();
+        for (cv::Point2f &corner : corners)
+            corner += shift;
+        markers.emplace_back(marker.getId(), corners);
+    }
+
+    table.updateTableOnFrame(markers);
+    REQUIRE(table.getState() == detection::TableState::COMPLETED);
+    REQUIRE(cv::norm(table.getCorners()[2] - (acquired[2] + shift)) < 1e-3);
+
+    // With two markers last table is kept as it was
+    markers.pop_back();
+    table.updateTableOnFrame(markers);
+    REQUIRE(table.getState() == detection::TableState::HELD);
+    REQUIRE(cv::norm(table.getCorners()[1] - (acquired[1] + shift)) < 1e-3);
+}
+
+TEST_CASE( "Marker corners correspond to their places on the table", "[detection Table]" ) {
+    detection::Table table(600, 300);
+    table.updateTableOnFrame(tableMarkers());
+
+    // Corner chosen by updateTableOnFrame is the table corner, markers are seen without rotation,
+    // so the other corners are offset on the plane exactly as they are in the image
+    const cv::Point2f tableCorners[4] = { { 600, 0 }, { 600, 300 }, { 0, 300 }, { 0, 0 } };
+    std::vector<cv::Point3f> objectPoints;
+    std::vector<cv::Point2f> imagePoints;
+    REQUIRE(table.getMarkerCorrespondences(tableMarkers(), 20, objectPoints, imagePoints));
+    REQUIRE(objectPoints.size() == 16);
+    REQUIRE(imagePoints.size() == 16);
+    for (int id = 0; id < 4; ++id)
+    {
+        REQUIRE(cv::norm(imagePoints[4 * id] - table.getCorners()[id]) < 1e-3);
+        for (int i = 0; i < 4; ++i)
+        {
+            const cv::Point3f &object = objectPoints[4 * id + i];
+            REQUIRE(object.z == 0);
+            const cv::Point2f onTable = cv::Point2f(object.x, object.y) - tableCorners[id];
+            REQUIRE(cv::norm(onTable - (imagePoints[4 * id + i] - imagePoints[4 * id])) < 1e-3);
+        }
+    }
+
+    // Marker 0 is entered at its inner corner on the top edge, its next corner is 20 units further right
+    REQUIRE(cv::norm(imagePoints[0] - cv::Point2f(680, 50)) < 1e-3);
+    REQUIRE(cv::norm(cv::Point2f(objectPoints[1].x, objectPoints[1].y) - cv::Point2f(620, 0)) < 1e-3);
+
+    // Completed corner is only a guess, such frames give no correspondences
+    std::vector<aruco::ArucoMarker> markers = tableMarkers();
+    markers.pop_back();
+    table.updateTableOnFrame(markers);
+    REQUIRE_FALSE(table.getMarkerCorrespondences(markers, 20, objectPoints, imagePoints));
+    REQUIRE(objectPoints.empty());
+}